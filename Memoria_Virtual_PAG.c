@@ -8,16 +8,73 @@
  * sistema de memoria virtual con tres niveles de tablas de páginas. El programa descompone 
  * direcciones virtuales de 36 bits en sus componentes y calcula el tiempo de acceso a memoria 
  * en base a una tasa de aciertos en el TLB.
+ * Los tiempos del modelo se pueden medir en la máquina anfitriona con el modo de calibración,
+ * que guarda los resultados en un fichero de configuración que se lee al arrancar.
+ * Un simulador de TLB reproduce trazas de direcciones a través de decompose_address y de una
+ * tabla de páginas de tres niveles, con entradas que pueden cubrir varias páginas contiguas.
+ * Una pasada de la traza basta para obtener los fallos de todas las geometrías LRU, y
+ * varias políticas de reemplazo compiten en paralelo sobre la misma traza decodificada.
+ * Los fallos del TLB pueden disparar prebúsquedas de traducciones (secuencial, por
+ * instrucción o por distancias). Los fallos por conflicto se comparan entre TLB asociativos,
+ * con TLB de víctimas y sesgados. Un modelo con tiempos de un TLB no bloqueante solapa los
+ * recorridos de la tabla de páginas de accesos independientes. Un simulador por eventos
+ * discretos, con una rueda de tiempos jerárquica, reproduce además la contención en la DRAM
+ * y en el intercambio; sobre él, miles de hilos simulados escritos como corrutinas se
+ * suspenden en sus fallos mientras los demás siguen. Los barridos de parámetros y de trozos
+ * de traza se reparten entre hilos que se roban el trabajo. Las trazas largas se pueden
+ * simular sólo en los intervalos representativos de sus fases, o en ventanas cortas al
+ * azar hasta que el intervalo de confianza alcanza la precisión pedida.
+ *
+ * Compilación: gcc -O2 -pthread Memoria_Virtual_PAG.c -o memoria_virtual -lm
+ * Uso: ./memoria_virtual                 (descomposición interactiva de una dirección)
+ *      ./memoria_virtual calibrate       (mide latencias de TLB, recorrido y DRAM del anfitrión)
+ *      ./memoria_virtual coalesce [accesos | fichero] (TLB con entradas coalescidas frente a normal)
+ *      ./memoria_virtual lookup [accesos | fichero]   (búsqueda en el TLB escalar frente a AVX2)
+ *      ./memoria_virtual sweep [accesos | fichero]    (fallos de todas las geometrías en una pasada)
+ *      ./memoria_virtual tournament [accesos | fichero] (políticas de reemplazo en paralelo)
+ *      ./memoria_virtual prefetch [accesos | fichero] (prebúsqueda de traducciones en el TLB)
+ *      ./memoria_virtual conflict [accesos | fichero] (TLB de víctimas y sesgado frente a asociativo)
+ *      ./memoria_virtual mshr [accesos | fichero]     (TLB no bloqueante con varios recorridos en vuelo)
+ *      ./memoria_virtual events [accesos | fichero]   (simulación por eventos con contención en DRAM e intercambio)
+ *      ./memoria_virtual coroutines [hilos [anfitriones]] (miles de hilos simulados con fallos solapados)
+ *      ./memoria_virtual pool [accesos | fichero] [trabajadores] (barrido con robo de trabajo)
+ *      ./memoria_virtual simpoint [accesos | fichero] (simulación de los intervalos representativos de cada fase)
+ *      ./memoria_virtual smarts [accesos | fichero] [precisión %] (muestreo estadístico con intervalo de confianza)
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <sched.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <pthread.h>
 
 #define PAGE_SIZE (1 << 12) // Tamaño de página de 4KB
 #define ADDRESS_SIZE 36     // Dirección virtual de 36 bits
 #define TLB_HIT_TIME 8      // Tiempo de acceso al TLB en nanosegundos (ns)
 #define MEMORY_ACCESS_TIME 70 // Tiempo de acceso a la memoria principal en ns
 #define TLB_HIT_RATE 0.9    // Tasa de aciertos en el TLB (90%)
+#define TIMING_CONFIG_FILE "memoria.cfg" // Fichero con los tiempos calibrados
+
+// Parámetros de la calibración
+#define CACHE_LINE_SIZE 64
+#define HUGE_PAGE_SIZE (1 << 21)              // Página grande (THP) de 2MB
+#define CALIBRATION_BUFFER_SIZE (256 << 20)   // Búfer mucho mayor que la caché y que el alcance del TLB
+#define CALIBRATION_LOADS 10000000            // Cargas encadenadas por medición
+
+// Tiempos usados por el modelo; valen las constantes anteriores salvo que exista el fichero de configuración
+typedef struct {
+    double tlb_hit_time;        // Acceso con acierto en el TLB (ns)
+    double memory_access_time;  // Acceso a la memoria principal (ns)
+    double page_walk_time;      // Recorrido de las tablas de páginas tras un fallo del TLB (ns)
+    double tlb_hit_rate;        // Tasa de aciertos en el TLB
+} MemoryTiming;
+
+MemoryTiming memory_timing = {TLB_HIT_TIME, MEMORY_ACCESS_TIME, 3 * MEMORY_ACCESS_TIME, TLB_HIT_RATE};
 
 // Estructura que representa los componentes de una dirección virtual descompuesta
 typedef struct {
@@ -57,6 +114,26 @@ VirtualAddress decompose_address(unsigned int virtual_address) {
     return addr;
 }
 
+/**
+ * Función: memory_access_time_for
+ * Descripción: Tiempo promedio de acceso de calculate_memory_access_time con
+ *              unos tiempos dados en lugar de los globales, para poder
+ *              evaluarlo desde varios hilos con tiempos distintos.
+ */
+double memory_access_time_for(const MemoryTiming *timing) {
+    // Tiempo promedio de acceso al TLB considerando la tasa de aciertos
+    double tlb_access_time = timing->tlb_hit_rate * timing->tlb_hit_time;
+
+    // Tiempo de acceso a las tres tablas de páginas en caso de fallo en el TLB
+    double page_table_access_time = (1 - timing->tlb_hit_rate) * timing->page_walk_time;
+
+    // Tiempo de acceso a la memoria principal (lectura/escritura)
+    double memory_access_time = timing->memory_access_time;
+
+    // Tiempo promedio total: TLB + tablas de páginas (si falla el TLB) + memoria
+    return tlb_access_time + page_table_access_time + memory_access_time;
+}
+
 /**
  * Función: calculate_memory_access_time
  * Descripción: Calcula el tiempo promedio de acceso a memoria considerando el
@@ -66,32 +143,3715 @@ VirtualAddress decompose_address(unsigned int virtual_address) {
  *   - Si hay un acierto en el TLB, el tiempo de acceso es el tiempo del TLB.
  *   - Si hay un fallo en el TLB, se debe acceder a las tres tablas de páginas
  *     y finalmente a la memoria principal.
+ * Los tiempos salen de memory_timing (constantes por defecto o valores
+ * calibrados leídos de TIMING_CONFIG_FILE).
  * Retorno:
  *   - Tiempo promedio de acceso a memoria en nanosegundos.
  */
 double calculate_memory_access_time() {
-    // Tiempo promedio de acceso al TLB considerando la tasa de aciertos
-    double tlb_access_time = TLB_HIT_RATE * TLB_HIT_TIME;
+    return memory_access_time_for(&memory_timing);
+}
 
-    // Tiempo de acceso a las tres tablas de páginas en caso de fallo en el TLB
-    double page_table_access_time = (1 - TLB_HIT_RATE) * (3 * MEMORY_ACCESS_TIME);
+/**
+ * Función: load_timing_config
+ * Descripción: Lee los tiempos del modelo de un fichero de configuración con
+ *              líneas "clave = valor". Las claves desconocidas se ignoran y las
+ *              ausentes conservan su valor por defecto.
+ * Parámetros:
+ *   - path: ruta del fichero de configuración.
+ * Retorno:
+ *   - 1 si se ha leído el fichero, 0 si no existe.
+ */
+int load_timing_config(const char *path) {
+    FILE *file = fopen(path, "r");
+    char line[128], key[64];
+    double value;
 
-    // Tiempo de acceso a la memoria principal (lectura/escritura)
-    double memory_access_time = MEMORY_ACCESS_TIME;
+    if (file == NULL) return 0;
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '#' || sscanf(line, " %63[^= \n] = %lf", key, &value) != 2) continue;
+        if (strcmp(key, "tlb_hit_time") == 0) memory_timing.tlb_hit_time = value;
+        else if (strcmp(key, "memory_access_time") == 0) memory_timing.memory_access_time = value;
+        else if (strcmp(key, "page_walk_time") == 0) memory_timing.page_walk_time = value;
+        else if (strcmp(key, "tlb_hit_rate") == 0) memory_timing.tlb_hit_rate = value;
+    }
+    fclose(file);
+    return 1;
+}
 
-    // Tiempo promedio total: TLB + tablas de páginas (si falla el TLB) + memoria
-    return tlb_access_time + page_table_access_time + memory_access_time;
+/**
+ * Función: save_timing_config
+ * Descripción: Escribe los tiempos actuales del modelo en el fichero de
+ *              configuración, en el formato que lee load_timing_config.
+ * Retorno:
+ *   - 1 si se ha escrito el fichero, 0 en caso de error.
+ */
+int save_timing_config(const char *path) {
+    FILE *file = fopen(path, "w");
+
+    if (file == NULL) return 0;
+    fprintf(file, "# Tiempos calibrados en el anfitrión (ns)\n");
+    fprintf(file, "tlb_hit_time = %.2f\n", memory_timing.tlb_hit_time);
+    fprintf(file, "memory_access_time = %.2f\n", memory_timing.memory_access_time);
+    fprintf(file, "page_walk_time = %.2f\n", memory_timing.page_walk_time);
+    fprintf(file, "tlb_hit_rate = %.4f\n", memory_timing.tlb_hit_rate);
+    fclose(file);
+    return 1;
 }
 
-/*
- * Función principal:
- *    - Solicita al usuario ingresar una dirección virtual en hexadecimal.
- *    - Descompone la dirección en sus índices de tabla y el offset correspondiente.
- *    - Calcula y muestra el tiempo promedio de acceso a memoria.
+/**
+ * Función: now_ns
+ * Descripción: Reloj monótono en nanosegundos.
  */
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
 
-int main() {
-    unsigned int virtual_address;
+/**
+ * Función: map_calibration_buffer
+ * Descripción: Reserva un búfer alineado a 2MB y pide al núcleo páginas
+ *              grandes (MADV_HUGEPAGE) o páginas de 4KB (MADV_NOHUGEPAGE).
+ *              El búfer se toca después del madvise para que los fallos de
+ *              página ya se sirvan con el tamaño pedido.
+ * Parámetros:
+ *   - size: tamaño útil del búfer.
+ *   - huge: 1 para páginas grandes, 0 para páginas de 4KB.
+ *   - raw: devuelve el inicio de la proyección para liberarla.
+ * Retorno:
+ *   - Puntero alineado al búfer, o NULL si mmap falla.
+ */
+static uint8_t *map_calibration_buffer(size_t size, int huge, uint8_t **raw) {
+    *raw = mmap(NULL, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (*raw == MAP_FAILED) return NULL;
+
+    uint8_t *buffer = (uint8_t *)(((uintptr_t)*raw + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+#ifdef MADV_HUGEPAGE
+    if (madvise(buffer, size, huge ? MADV_HUGEPAGE : MADV_NOHUGEPAGE) != 0 && huge) {
+        printf("Aviso: el núcleo no admite MADV_HUGEPAGE, se usan páginas de 4KB\n");
+    }
+#endif
+    memset(buffer, 1, size);
+    return buffer;
+}
+
+/**
+ * Función: huge_pages_kb
+ * Descripción: Memoria del proceso respaldada por páginas grandes, según
+ *              /proc/self/smaps_rollup (0 si no está disponible).
+ */
+static long huge_pages_kb(void) {
+    FILE *file = fopen("/proc/self/smaps_rollup", "r");
+    char line[128];
+    long kb = 0;
+
+    if (file == NULL) return 0;
+    while (fgets(line, sizeof(line), file)) {
+        if (sscanf(line, "AnonHugePages: %ld", &kb) == 1) break;
+    }
+    fclose(file);
+    return kb;
+}
+
+/**
+ * Función: pointer_chase
+ * Descripción: Enlaza num_slots posiciones del búfer (cada una a 'stride'
+ *              bytes de la anterior) en un ciclo aleatorio y lo recorre con
+ *              cargas dependientes, de modo que cada carga espera a la
+ *              anterior y el tiempo medido es la latencia pura. Dentro de cada
+ *              paso la posición se desplaza un número de líneas que depende
+ *              del índice, para no concentrar las cargas en pocos conjuntos de
+ *              la caché (con páginas de 2MB los bits altos del conjunto ya no
+ *              son aleatorios).
+ * Parámetros:
+ *   - buffer: búfer de la medición.
+ *   - num_slots: número de posiciones del ciclo.
+ *   - stride: distancia en bytes entre posiciones consecutivas.
+ * Retorno:
+ *   - Latencia media por carga en nanosegundos.
+ */
+static double pointer_chase(uint8_t *buffer, size_t num_slots, size_t stride) {
+    uint32_t *order = malloc(num_slots * sizeof(uint32_t));
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+
+    for (size_t i = 0; i < num_slots; i++) order[i] = i;
+    for (size_t i = num_slots - 1; i > 0; i--) {
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        size_t j = seed % (i + 1);
+        uint32_t tmp = order[i]; order[i] = order[j]; order[j] = tmp;
+    }
+    size_t shift_mask = (stride < PAGE_SIZE ? stride : PAGE_SIZE) - 1;
+    for (size_t i = 0; i < num_slots; i++) {
+        size_t from = order[i], to = order[(i + 1) % num_slots];
+        void **slot = (void **)(buffer + from * stride + (((from ^ (from >> 5)) * CACHE_LINE_SIZE) & shift_mask));
+        *slot = buffer + to * stride + (((to ^ (to >> 5)) * CACHE_LINE_SIZE) & shift_mask);
+    }
+    free(order);
+
+    // Un recorrido completo de calentamiento (la posición 0 está en el ciclo) y después la medición
+    void **p = (void **)buffer;
+    for (size_t i = 0; i < num_slots; i++) p = (void **)*p;
+    double start = now_ns();
+    for (long i = 0; i < CALIBRATION_LOADS; i++) p = (void **)*p;
+    double elapsed = now_ns() - start;
+    __asm__ volatile("" : : "r"(p)); // El resultado del recorrido se usa: el bucle no se elimina
+
+    return elapsed / CALIBRATION_LOADS;
+}
+
+/**
+ * Función: run_calibration
+ * Descripción: Mide en el anfitrión los tiempos que usa el modelo y los guarda
+ *              en TIMING_CONFIG_FILE:
+ *   - Acierto de TLB: recorrido de pocas líneas repartidas en pocas páginas
+ *     (dentro de la caché L1 y del alcance del TLB).
+ *   - Recorrido de tablas: una línea por página sobre muchas más páginas de
+ *     las que cubre el TLB; los datos caben en caché, así que la diferencia
+ *     entre páginas de 4KB y páginas grandes es el coste del recorrido.
+ *   - DRAM: líneas aleatorias sobre un búfer de 256MB con páginas grandes, que
+ *     caben en el TLB; la diferencia con 4KB confirma el recorrido con fallos
+ *     de caché en las propias tablas.
+ * Retorno:
+ *   - 1 si los tiempos se midieron y guardaron, 0 si falla mmap o la escritura.
+ */
+int run_calibration(void) {
+    uint8_t *raw_small, *raw_huge;
+    uint8_t *small = map_calibration_buffer(CALIBRATION_BUFFER_SIZE, 0, &raw_small);
+    uint8_t *huge = map_calibration_buffer(CALIBRATION_BUFFER_SIZE, 1, &raw_huge);
+
+    if (small == NULL || huge == NULL) {
+        perror("mmap");
+        // Se libera el búfer que sí se pudo proyectar
+        if (small != NULL) munmap(raw_small, CALIBRATION_BUFFER_SIZE + HUGE_PAGE_SIZE);
+        if (huge != NULL) munmap(raw_huge, CALIBRATION_BUFFER_SIZE + HUGE_PAGE_SIZE);
+        return 0;
+    }
+
+    printf("Calibrando latencias del anfitrión (%d cargas dependientes por medición)...\n", CALIBRATION_LOADS);
+    printf("Páginas grandes obtenidas: %ld de %d MB\n", huge_pages_kb() / 1024, CALIBRATION_BUFFER_SIZE >> 20);
+    double hit = pointer_chase(small, 16, PAGE_SIZE);
+    double stride_small = pointer_chase(small, 8192, PAGE_SIZE);
+    double stride_huge = pointer_chase(huge, 8192, PAGE_SIZE);
+    double dram_small = pointer_chase(small, CALIBRATION_BUFFER_SIZE / CACHE_LINE_SIZE, CACHE_LINE_SIZE);
+    double dram_huge = pointer_chase(huge, CALIBRATION_BUFFER_SIZE / CACHE_LINE_SIZE, CACHE_LINE_SIZE);
+
+    printf(" %-44s %10s %10s\n", "Medición", "4KB (ns)", "2MB (ns)");
+    printf(" %-44s %10.2f %10s\n", "16 páginas, una línea por página", hit, "-");
+    printf(" %-44s %10.2f %10.2f\n", "8192 páginas, una línea por página", stride_small, stride_huge);
+    printf(" %-44s %10.2f %10.2f\n", "líneas aleatorias en 256MB", dram_small, dram_huge);
+
+    memory_timing.tlb_hit_time = hit;
+    memory_timing.memory_access_time = dram_huge;
+    memory_timing.page_walk_time = dram_small - dram_huge > stride_small - stride_huge
+                                   ? dram_small - dram_huge : stride_small - stride_huge;
+    if (memory_timing.page_walk_time < 0) memory_timing.page_walk_time = 0;
+
+    printf("Acierto de TLB: %.2f ns, recorrido de tablas: %.2f ns (con tablas en caché: %.2f ns), DRAM: %.2f ns\n",
+           memory_timing.tlb_hit_time, memory_timing.page_walk_time, stride_small - stride_huge,
+           memory_timing.memory_access_time);
+    int saved = save_timing_config(TIMING_CONFIG_FILE);
+    if (saved) {
+        printf("Tiempos guardados en %s\n", TIMING_CONFIG_FILE);
+    } else {
+        perror(TIMING_CONFIG_FILE);
+    }
+    printf("Tiempo promedio de acceso con los tiempos calibrados: %.2f ns\n", calculate_memory_access_time());
+
+    munmap(raw_small, CALIBRATION_BUFFER_SIZE + HUGE_PAGE_SIZE);
+    munmap(raw_huge, CALIBRATION_BUFFER_SIZE + HUGE_PAGE_SIZE);
+    return saved;
+}
+
+/* ------------------------------------------------------------------------
+ * Simulador de TLB
+ * ------------------------------------------------------------------------
+ * Las direcciones de una traza se descomponen con decompose_address y el
+ * número de página virtual (índices de nivel 1, 2 y 3) se traduce con un TLB
+ * asociativo por conjuntos. Cada fallo recorre la tabla de páginas de tres
+ * niveles. En modo coalescido una entrada puede cubrir un grupo alineado de
+ * COALESCE_PAGES páginas virtuales y guarda una máscara con las páginas del
+ * grupo cuyos marcos son contiguos a partir de un marco base (como CoLT o la
+ * coalescencia de PTE de AMD). Las oportunidades se detectan al rellenar la
+ * entrada, mirando las PTE vecinas de la misma línea de la tabla de nivel 3.
+ * Una página sin vecinas contiguas ocupa una entrada normal, en el conjunto
+ * que dan los bits bajos de su número como en un TLB convencional; sólo los
+ * grupos de dos o más páginas usan una entrada de grupo, en el conjunto del
+ * número de grupo. La búsqueda mira primero el conjunto de la página y, si
+ * falla, el de su grupo. (Indexar todas las páginas por el grupo hacía que
+ * las 8 páginas de un grupo sin contigüidad compitiesen por un conjunto.)
+ * Las etiquetas de cada conjunto están contiguas en memoria y, con 8 o 16 vías,
+ * se comparan todas a la vez con AVX2; el estado de reemplazo va aparte para
+ * que la búsqueda sólo toque la línea de etiquetas del conjunto.
+ */
+
+#define COALESCE_PAGES 8                  // Páginas por entrada coalescida (8 PTE = una línea de 64 bytes)
+#define TLB_INVALID_TAG 0xFFFFFFFFu       // Etiqueta de una entrada libre
+#define COALESCE_GROUP_TAG 0x80000000u    // Marca de la etiqueta de una entrada que cubre varias páginas
+#define TRACE_DEFAULT_LENGTH 4000000      // Accesos de la traza sintética
+#define REACH_SAMPLE_INTERVAL 4096        // Accesos entre dos muestras del alcance del TLB
+
+// Traza de direcciones virtuales
+typedef struct {
+    unsigned int *addresses;
+    unsigned int *pcs;      // Instrucción que hace cada acceso; NULL si la traza no la incluye
+    long length;
+} Trace;
+
+// Tabla de páginas de tres niveles; las tablas de nivel 3 se reservan al asignar su primera página
+typedef struct {
+    int *tables[16][256];   // tables[nivel 1][nivel 2]: 256 marcos, -1 si la página no está asignada
+} PageTable;
+
+// Políticas de reemplazo del TLB
+typedef enum {
+    REPLACE_LRU,            // La entrada usada hace más tiempo
+    REPLACE_FIFO,           // La entrada rellenada hace más tiempo
+    REPLACE_RANDOM,         // Una vía al azar
+    REPLACE_CLOCK           // Segunda oportunidad con un bit de referencia y una manecilla por conjunto
+} TlbReplacement;
+
+// TLB asociativo por conjuntos
+typedef struct {
+    int sets;               // Número de conjuntos (potencia de 2)
+    int ways;               // Vías por conjunto
+    int coalesce;           // 1 si una entrada puede cubrir un grupo de COALESCE_PAGES páginas
+    int use_simd;           // 1 si la búsqueda compara las vías con AVX2 (vías múltiplo de 8)
+    int skewed;             // 1 si cada vía elige el conjunto con su propia función hash
+    uint32_t *tags;         // tags[set * ways + way]: página (o grupo) de la entrada, contiguas por conjunto
+    int *frames;            // Marco de la página (o marco base del grupo)
+    uint8_t *masks;         // Páginas válidas del grupo (modo coalescido)
+    uint64_t *lru;          // Estado de reemplazo: último uso (LRU), relleno (FIFO) o bit de referencia (reloj)
+    uint64_t clock;         // Accesos realizados: de 64 bits para trazas de más de 2^32 accesos
+    TlbReplacement replacement;
+    int *hands;             // Manecilla de cada conjunto (reloj)
+    uint64_t rng;           // Generador de la política aleatoria
+    long accesses;
+    long misses;
+    long walks;             // Recorridos de la tabla de páginas
+} Tlb;
+
+/**
+ * Función: virtual_page_number
+ * Descripción: Reúne los índices de los tres niveles en el número de página virtual.
+ */
+unsigned int virtual_page_number(VirtualAddress addr) {
+    return (addr.lvl1_index << 16) | (addr.lvl2_index << 8) | addr.lvl3_index;
+}
+
+/**
+ * Función: trace_generate
+ * Descripción: Genera una traza sintética con cinco comportamientos, cada uno
+ *              desde sus propias instrucciones: una zona pequeña y muy usada
+ *              (código y pila), recorridos secuenciales de un vector grande,
+ *              un recorrido de estructuras de 3 páginas, una lista enlazada
+ *              cuyos nodos se reservaron con un patrón repetido de distancias
+ *              entre páginas y accesos aleatorios a un montículo.
+ * Parámetros:
+ *   - length: número de accesos.
+ *   - seed: semilla del generador.
+ */
+Trace trace_generate(long length, uint64_t seed) {
+    static const int list_steps[] = {2, 5, -1, 3}; // Distancias entre páginas de nodos consecutivos
+    Trace trace = {malloc(length * sizeof(unsigned int)), malloc(length * sizeof(unsigned int)), length};
+    unsigned int stream = 0, strided = 0, list_page = 0, list_visits = 0;
+
+    if (trace.addresses == NULL || trace.pcs == NULL) return trace;
+
+    for (long i = 0; i < length; i++) {
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        unsigned int r = (unsigned int)(seed >> 32);
+        unsigned int kind = r % 20;
+        if (kind < 6) {
+            trace.addresses[i] = 0x00400000u + (r >> 8) % (16 * PAGE_SIZE);          // Código y pila: 16 páginas
+            trace.pcs[i] = 0x401000u + (r >> 5) % 8 * 4;
+        } else if (kind < 14) {
+            trace.addresses[i] = 0x10000000u + stream % (2048u * PAGE_SIZE);         // Vector de 8MB
+            trace.pcs[i] = 0x401124u;
+            stream += CACHE_LINE_SIZE;
+        } else if (kind < 16) {
+            trace.addresses[i] = 0x40000000u + strided % (6144u * PAGE_SIZE);        // Estructuras de 12KB
+            trace.pcs[i] = 0x401238u;
+            strided += 3 * PAGE_SIZE;
+        } else if (kind < 18) {
+            trace.addresses[i] = 0x30000000u + list_page * PAGE_SIZE + (r >> 8) % PAGE_SIZE; // Lista: 4 accesos por nodo
+            trace.pcs[i] = 0x40134cu;
+            if (++list_visits % 4 == 0) list_page = (list_page + 4096 + list_steps[list_visits / 4 % 4]) % 4096;
+        } else {
+            trace.addresses[i] = 0x20000000u + (r >> 4) % (4096u * PAGE_SIZE);       // Montículo de 16MB
+            trace.pcs[i] = 0x401460u;
+        }
+    }
+    return trace;
+}
+
+void trace_free(Trace *trace) {
+    free(trace->addresses);
+    free(trace->pcs);
+}
+
+/**
+ * Función: trace_load
+ * Descripción: Lee una traza binaria de direcciones de 32 bits.
+ * Retorno:
+ *   - Traza leída; longitud 0 si el fichero no se puede abrir o está vacío.
+ */
+Trace trace_load(const char *path) {
+    Trace trace = {NULL, NULL, 0};
+    FILE *file = fopen(path, "rb");
+
+    if (file == NULL) {
+        perror(path);
+        return trace;
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file) / (long)sizeof(unsigned int);
+    fseek(file, 0, SEEK_SET);
+    if (length > 0) trace.addresses = malloc(length * sizeof(unsigned int));
+    if (trace.addresses) trace.length = fread(trace.addresses, sizeof(unsigned int), length, file);
+    fclose(file);
+    return trace;
+}
+
+/**
+ * Función: trace_open
+ * Descripción: Traza de los modos de simulación: un argumento numérico es la
+ *              longitud de una traza sintética, cualquier otro un fichero (un
+ *              fichero de nombre numérico se indica como ./nombre).
+ * Retorno:
+ *   - 1 si la traza está lista; 0 si la longitud no es un entero positivo o
+ *     el fichero no se puede leer o está vacío (ya se ha informado del error).
+ */
+int trace_open(int argc, char *argv[], Trace *trace) {
+    long length = TRACE_DEFAULT_LENGTH;
+
+    if (argc > 2) {
+        char *end;
+        length = strtol(argv[2], &end, 10);
+        if (end == argv[2] || *end != '\0') {
+            *trace = trace_load(argv[2]);
+            if (trace->length > 0) return 1;
+            fprintf(stderr, "La traza %s está vacía o no se puede leer\n", argv[2]);
+            trace_free(trace);
+            return 0;
+        }
+        if (length <= 0) {
+            fprintf(stderr, "La longitud de la traza debe ser un entero positivo\n");
+            return 0;
+        }
+    }
+    *trace = trace_generate(length, 0x9E3779B97F4A7C15ULL);
+    if (trace->addresses == NULL || trace->pcs == NULL) {
+        fprintf(stderr, "No hay memoria para una traza de %ld accesos\n", length);
+        trace_free(trace);
+        return 0;
+    }
+    return 1;
+}
+
+PageTable *page_table_create(void) {
+    return calloc(1, sizeof(PageTable));
+}
+
+void page_table_destroy(PageTable *pt) {
+    for (int l1 = 0; l1 < 16; l1++) {
+        for (int l2 = 0; l2 < 256; l2++) free(pt->tables[l1][l2]);
+    }
+    free(pt);
+}
+
+/**
+ * Función: page_table_map
+ * Descripción: Asigna un marco a una página virtual.
+ */
+void page_table_map(PageTable *pt, unsigned int vpn, int frame) {
+    int **leaf = &pt->tables[(vpn >> 16) & 0xF][(vpn >> 8) & 0xFF];
+    if (*leaf == NULL) {
+        *leaf = malloc(256 * sizeof(int));
+        for (int i = 0; i < 256; i++) (*leaf)[i] = -1;
+    }
+    (*leaf)[vpn & 0xFF] = frame;
+}
+
+/**
+ * Función: page_table_leaf
+ * Descripción: Tabla de nivel 3 que contiene una página, o NULL si no existe.
+ */
+static const int *page_table_leaf(const PageTable *pt, unsigned int vpn) {
+    return pt->tables[(vpn >> 16) & 0xF][(vpn >> 8) & 0xFF];
+}
+
+/**
+ * Función: page_table_walk
+ * Descripción: Recorre los tres niveles de la tabla de páginas.
+ * Retorno:
+ *   - Marco de la página, o -1 si no está asignada.
+ */
+int page_table_walk(const PageTable *pt, unsigned int vpn) {
+    const int *leaf = page_table_leaf(pt, vpn);
+    return leaf ? leaf[vpn & 0xFF] : -1;
+}
+
+/**
+ * Función: page_table_build
+ * Descripción: Asigna marcos a todas las páginas que toca la traza, en orden de
+ *              página virtual y por extensiones de 4 a 64 páginas. Una fracción
+ *              de las extensiones ocupa marcos contiguos; en las demás cada
+ *              página cae en un marco suelto.
+ * Parámetros:
+ *   - trace: traza cuyas páginas se asignan.
+ *   - contiguous_fraction: fracción de extensiones con marcos contiguos.
+ *   - seed: semilla del generador.
+ */
+PageTable *page_table_build(const Trace *trace, double contiguous_fraction, uint64_t seed) {
+    PageTable *pt = page_table_create();
+    uint64_t *touched = calloc((1 << 20) / 64, sizeof(uint64_t));
+    int next_frame = 0, remaining = 0, scattered = 0;
+    long last_vpn = -2;
+
+    for (long i = 0; i < trace->length; i++) {
+        unsigned int vpn = virtual_page_number(decompose_address(trace->addresses[i]));
+        touched[vpn / 64] |= 1ULL << (vpn % 64);
+    }
+    for (long vpn = 0; vpn < (1 << 20); vpn++) {
+        if (!(touched[vpn / 64] >> (vpn % 64) & 1)) continue;
+        int new_extent = remaining == 0 || vpn != last_vpn + 1;
+        if (new_extent) {
+            seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+            remaining = 4 << (seed % 5);
+            scattered = (seed >> 11) * (1.0 / 9007199254740992.0) >= contiguous_fraction;
+        }
+        if (new_extent || scattered) {
+            seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+            next_frame += 1 + seed % 8; // Hueco: la página no continúa a la anterior
+        }
+        page_table_map(pt, vpn, next_frame++);
+        remaining--;
+        last_vpn = vpn;
+    }
+    free(touched);
+    return pt;
+}
+
+Tlb *tlb_create(int sets, int ways, int coalesce) {
+    Tlb *tlb = calloc(1, sizeof(Tlb));
+    tlb->sets = sets;
+    tlb->ways = ways;
+    tlb->coalesce = coalesce;
+    tlb->use_simd = 0;
+#if defined(__x86_64__)
+    tlb->use_simd = ways % 8 == 0 && __builtin_cpu_supports("avx2");
+#endif
+    tlb->tags = aligned_alloc(32, ((sets * ways * sizeof(uint32_t)) + 31) & ~(size_t)31);
+    tlb->frames = calloc(sets * ways, sizeof(int));
+    tlb->masks = calloc(sets * ways, sizeof(uint8_t));
+    tlb->lru = calloc(sets * ways, sizeof(uint64_t));
+    tlb->hands = calloc(sets, sizeof(int));
+    tlb->replacement = REPLACE_LRU;
+    tlb->rng = 0x853C49E6748FEA9BULL;
+    for (int i = 0; i < sets * ways; i++) tlb->tags[i] = TLB_INVALID_TAG;
+    return tlb;
+}
+
+void tlb_set_replacement(Tlb *tlb, TlbReplacement replacement) {
+    tlb->replacement = replacement;
+}
+
+/**
+ * Función: tlb_set_skewed
+ * Descripción: Convierte el TLB en asociativo sesgado: la vía w de una página
+ *              está en el conjunto skew_hash(página, w), así que dos páginas
+ *              que chocan en una vía casi nunca chocan en las demás. La
+ *              búsqueda es escalar y el reemplazo usa los instantes de uso
+ *              (el reloj por conjunto no tiene sentido con conjuntos
+ *              distintos en cada vía).
+ */
+void tlb_set_skewed(Tlb *tlb) {
+    tlb->skewed = 1;
+    tlb->use_simd = 0;
+    if (tlb->replacement == REPLACE_CLOCK) tlb->replacement = REPLACE_LRU;
+}
+
+/**
+ * Función: skew_hash
+ * Descripción: Conjunto de una etiqueta en la vía 'way' de un TLB sesgado:
+ *              hash multiplicativo con una constante impar distinta por vía.
+ */
+static inline int skew_hash(const Tlb *tlb, uint32_t tag, int way) {
+    static const uint32_t factors[] = {0x9E3779B1u, 0x85EBCA77u, 0xC2B2AE3Du, 0x27D4EB2Fu,
+                                       0x165667B1u, 0xD3A2646Du, 0xFD7046C5u, 0xB55A4F09u};
+    uint32_t h = (tag ^ (tag >> 15)) * factors[way % 8] + (uint32_t)way;
+    return (h >> 16) & (tlb->sets - 1);
+}
+
+void tlb_destroy(Tlb *tlb) {
+    free(tlb->tags);
+    free(tlb->frames);
+    free(tlb->masks);
+    free(tlb->lru);
+    free(tlb->hands);
+    free(tlb);
+}
+
+/**
+ * Función: tlb_lookup_scalar
+ * Descripción: Busca una etiqueta en las vías de su conjunto, una a una. En
+ *              modo coalescido un grupo puede ocupar varias entradas (una por
+ *              cada tramo de marcos contiguos), así que además debe estar
+ *              activo el bit de la página en la máscara.
+ * Retorno:
+ *   - Posición de la entrada (conjunto * vías + vía), o -1 si no está.
+ */
+int tlb_lookup_scalar(const Tlb *tlb, uint32_t tag, int index) {
+    int base = (tag & (tlb->sets - 1)) * tlb->ways;
+    for (int i = base; i < base + tlb->ways; i++) {
+        if (tlb->tags[i] == tag && (!tlb->coalesce || (tlb->masks[i] >> index & 1))) return i;
+    }
+    return -1;
+}
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+/**
+ * Función: tlb_lookup_avx2
+ * Descripción: Igual que tlb_lookup_scalar, pero compara 8 etiquetas por
+ *              instrucción: movemask deja un bit por vía coincidente y ctz da
+ *              la vía, sin saltos que dependan de la vía en que está la
+ *              página. Requiere un número de vías múltiplo de 8.
+ */
+__attribute__((target("avx2")))
+int tlb_lookup_avx2(const Tlb *tlb, uint32_t tag, int index) {
+    int base = (tag & (tlb->sets - 1)) * tlb->ways;
+    __m256i key = _mm256_set1_epi32((int)tag);
+    uint64_t hits = 0;
+
+    for (int way = 0; way < tlb->ways; way += 8) {
+        __m256i tags = _mm256_load_si256((const __m256i *)(tlb->tags + base + way));
+        hits |= (uint64_t)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(tags, key))) << way;
+    }
+    if (tlb->coalesce) {
+        // Varias entradas pueden tener la etiqueta del grupo: vale la que tenga la página en su máscara
+        for (uint64_t candidates = hits; candidates; candidates &= candidates - 1) {
+            int way = __builtin_ctzll(candidates);
+            if (!(tlb->masks[base + way] >> index & 1)) hits &= ~(1ULL << way);
+        }
+    }
+    // Sin salto de acierto/fallo: con ctz de hits | bit 63 el fallo da 63 y se corrige con una máscara
+    int miss = hits == 0;
+    return (base + __builtin_ctzll(hits | (1ULL << 63))) | -miss;
+}
+#endif
+
+/**
+ * Función: tlb_lookup_skewed
+ * Descripción: Búsqueda en un TLB sesgado: cada vía se mira en su propio conjunto.
+ */
+static int tlb_lookup_skewed(const Tlb *tlb, uint32_t tag, int index) {
+    for (int way = 0; way < tlb->ways; way++) {
+        int slot = skew_hash(tlb, tag, way) * tlb->ways + way;
+        if (tlb->tags[slot] == tag && (!tlb->coalesce || (tlb->masks[slot] >> index & 1))) return slot;
+    }
+    return -1;
+}
+
+/**
+ * Función: tlb_lookup
+ * Descripción: Búsqueda en el TLB con la implementación que corresponda.
+ */
+int tlb_lookup(const Tlb *tlb, uint32_t tag, int index) {
+    if (tlb->skewed) return tlb_lookup_skewed(tlb, tag, index);
+#if defined(__x86_64__)
+    if (tlb->use_simd) return tlb_lookup_avx2(tlb, tag, index);
+#endif
+    return tlb_lookup_scalar(tlb, tag, index);
+}
+
+/**
+ * Función: tlb_victim
+ * Descripción: Entrada que se sustituye en el conjunto de una etiqueta: una
+ *              libre si la hay y si no la que elija la política de reemplazo.
+ */
+static int tlb_victim(Tlb *tlb, uint32_t tag) {
+    int set = tag & (tlb->sets - 1), base = set * tlb->ways, victim = base;
+    if (tlb->skewed) {
+        // Candidatas: la entrada de cada vía en el conjunto que le da su hash
+        int candidate = skew_hash(tlb, tag, 0) * tlb->ways;
+        victim = candidate;
+        if (tlb->replacement == REPLACE_RANDOM) {
+            tlb->rng ^= tlb->rng << 13; tlb->rng ^= tlb->rng >> 7; tlb->rng ^= tlb->rng << 17;
+        }
+        for (int way = 0; way < tlb->ways; way++) {
+            candidate = skew_hash(tlb, tag, way) * tlb->ways + way;
+            if (tlb->tags[candidate] == TLB_INVALID_TAG) return candidate;
+            if (tlb->replacement == REPLACE_RANDOM ? way == (int)(tlb->rng % tlb->ways)
+                                                   : tlb->lru[candidate] < tlb->lru[victim]) {
+                victim = candidate;
+            }
+        }
+        return victim;
+    }
+    for (int i = base; i < base + tlb->ways; i++) {
+        if (tlb->tags[i] == TLB_INVALID_TAG) return i;
+    }
+    switch (tlb->replacement) {
+    case REPLACE_RANDOM:
+        tlb->rng ^= tlb->rng << 13; tlb->rng ^= tlb->rng >> 7; tlb->rng ^= tlb->rng << 17;
+        return base + tlb->rng % tlb->ways;
+    case REPLACE_CLOCK:
+        // Se limpian bits de referencia hasta encontrar una entrada sin él
+        while (tlb->lru[base + tlb->hands[set]]) {
+            tlb->lru[base + tlb->hands[set]] = 0;
+            tlb->hands[set] = (tlb->hands[set] + 1) % tlb->ways;
+        }
+        victim = base + tlb->hands[set];
+        tlb->hands[set] = (tlb->hands[set] + 1) % tlb->ways;
+        return victim;
+    default:
+        // LRU y FIFO: el menor instante guardado
+        for (int i = base; i < base + tlb->ways; i++) {
+            if (tlb->lru[i] < tlb->lru[victim]) victim = i;
+        }
+        return victim;
+    }
+}
+
+/**
+ * Función: tlb_touch
+ * Descripción: Actualiza el estado de reemplazo de una entrada que se usa o se rellena.
+ */
+static void tlb_touch(Tlb *tlb, int slot, int fill) {
+    if (tlb->replacement == REPLACE_CLOCK) {
+        tlb->lru[slot] = 1;
+    } else if (tlb->replacement == REPLACE_LRU || (fill && tlb->replacement == REPLACE_FIFO)) {
+        tlb->lru[slot] = tlb->clock;
+    }
+}
+
+/**
+ * Función: tlb_fill
+ * Descripción: Guarda la traducción de una página en el TLB. En modo
+ *              coalescido la entrada recoge además las páginas vecinas del
+ *              mismo grupo que están en marcos contiguos.
+ * Parámetros:
+ *   - evicted_frame: si no es NULL, recibe el marco de la entrada sustituida.
+ * Retorno:
+ *   - Etiqueta de la entrada sustituida, o TLB_INVALID_TAG si estaba libre.
+ */
+uint32_t tlb_fill(Tlb *tlb, const PageTable *pt, unsigned int vpn, int frame, int *evicted_frame) {
+    uint32_t tag = vpn;
+    int index = vpn % COALESCE_PAGES;
+    uint8_t mask = 1 << index;
+
+    if (tlb->coalesce) {
+        // Las 8 PTE del grupo están en la misma línea que la recorrida: la coalescencia no cuesta accesos extra
+        const int *group = page_table_leaf(pt, vpn) + (vpn & 0xFF & ~(COALESCE_PAGES - 1));
+        for (int i = 0; i < COALESCE_PAGES; i++) {
+            if (group[i] >= 0 && group[i] == frame - index + i) mask |= 1 << i;
+        }
+        if (mask != 1 << index) tag = COALESCE_GROUP_TAG | vpn / COALESCE_PAGES;
+    }
+
+    int slot = tlb_victim(tlb, tag);
+    uint32_t evicted = tlb->tags[slot];
+    if (evicted_frame) *evicted_frame = tlb->frames[slot];
+    tlb->tags[slot] = tag;
+    tlb_touch(tlb, slot, 1);
+    // En modo coalescido se guarda el marco base del grupo, también en las entradas de una página
+    tlb->frames[slot] = tlb->coalesce ? frame - index : frame;
+    tlb->masks[slot] = mask;
+    return evicted;
+}
+
+/**
+ * Función: tlb_find
+ * Descripción: Entrada que traduce una página: en modo coalescido, la
+ *              entrada de la página en su conjunto o, si no está, una
+ *              entrada de su grupo que la incluya.
+ */
+static int tlb_find(const Tlb *tlb, unsigned int vpn) {
+    int index = vpn % COALESCE_PAGES;
+    int slot = tlb_lookup(tlb, vpn, index);
+    if (slot < 0 && tlb->coalesce) slot = tlb_lookup(tlb, COALESCE_GROUP_TAG | vpn / COALESCE_PAGES, index);
+    return slot;
+}
+
+/**
+ * Función: tlb_probe
+ * Descripción: Busca una página en el TLB contando el acceso y, si acierta,
+ *              actualizando su estado de reemplazo.
+ * Retorno:
+ *   - Marco de la página, o -1 si falla.
+ */
+int tlb_probe(Tlb *tlb, unsigned int vpn) {
+    int index = vpn % COALESCE_PAGES;
+    int slot = tlb_find(tlb, vpn);
+
+    tlb->accesses++;
+    tlb->clock++;
+    if (slot < 0) return -1;
+    tlb_touch(tlb, slot, 0);
+    return tlb->frames[slot] + (tlb->coalesce ? index : 0);
+}
+
+/**
+ * Función: tlb_contains
+ * Descripción: Indica si el TLB tiene la traducción de una página, sin
+ *              contarlo como acceso.
+ */
+int tlb_contains(const Tlb *tlb, unsigned int vpn) {
+    return tlb_find(tlb, vpn) >= 0;
+}
+
+/**
+ * Función: tlb_translate
+ * Descripción: Traduce una página virtual. Si falla el TLB se recorre la tabla
+ *              de páginas y se rellena una entrada.
+ * Retorno:
+ *   - Marco de la página, o -1 si no está asignada.
+ */
+int tlb_translate(Tlb *tlb, const PageTable *pt, unsigned int vpn) {
+    int frame = tlb_probe(tlb, vpn);
+    if (frame >= 0) return frame;
+
+    tlb->misses++;
+    tlb->walks++;
+    frame = page_table_walk(pt, vpn);
+    if (frame >= 0) tlb_fill(tlb, pt, vpn, frame, NULL);
+    return frame;
+}
+
+/**
+ * Función: tlb_reach_pages
+ * Descripción: Páginas que traducen las entradas válidas del TLB en este momento.
+ */
+long tlb_reach_pages(const Tlb *tlb) {
+    long pages = 0;
+    for (int i = 0; i < tlb->sets * tlb->ways; i++) {
+        if (tlb->tags[i] == TLB_INVALID_TAG) continue;
+        pages += tlb->coalesce ? __builtin_popcount(tlb->masks[i]) : 1;
+    }
+    return pages;
+}
+
+/**
+ * Función: tlb_amat
+ * Descripción: Tiempo medio de acceso del modelo de calculate_memory_access_time
+ *              con la tasa de aciertos medida en una simulación.
+ */
+double tlb_amat(const Tlb *tlb) {
+    double configured_rate = memory_timing.tlb_hit_rate;
+    memory_timing.tlb_hit_rate = tlb->accesses ? 1.0 - (double)tlb->misses / tlb->accesses : 1.0;
+    double amat = calculate_memory_access_time();
+    memory_timing.tlb_hit_rate = configured_rate;
+    return amat;
+}
+
+/**
+ * Función: run_coalescing_comparison
+ * Descripción: Reproduce una traza a través de decompose_address con un TLB
+ *              convencional y con uno coalescido de la misma geometría
+ *              (asociativo de 4 vías y totalmente asociativo), para varias
+ *              proporciones de memoria física contigua, e informa de la
+ *              tasa de fallos, el alcance medio del TLB y el tiempo medio de
+ *              acceso resultante.
+ */
+void run_coalescing_comparison(const Trace *trace) {
+    const double fractions[] = {0.0, 0.5, 0.9, 1.0};
+    const int geometries[][2] = {{16, 4}, {1, 64}}; // Conjuntos y vías, 64 entradas en total
+
+    printf("Traza de %ld accesos, TLB de 64 entradas\n", trace->length);
+    printf(" %9s %9s %-11s %10s %10s %12s %10s\n", "Contigua", "Vías", "TLB", "Fallos", "Tasa", "Alcance KB", "AMAT ns");
+    for (int f = 0; f < 4; f++) {
+        PageTable *pt = page_table_build(trace, fractions[f], 0xD1B54A32D192ED03ULL);
+        for (int run = 0; run < 4; run++) {
+            int sets = geometries[run / 2][0], ways = geometries[run / 2][1], coalesce = run % 2;
+            Tlb *tlb = tlb_create(sets, ways, coalesce);
+            long reach = 0, samples = 0;
+            for (long i = 0; i < trace->length; i++) {
+                tlb_translate(tlb, pt, virtual_page_number(decompose_address(trace->addresses[i])));
+                if (i % REACH_SAMPLE_INTERVAL == REACH_SAMPLE_INTERVAL - 1) {
+                    reach += tlb_reach_pages(tlb);
+                    samples++;
+                }
+            }
+            printf(" %8.0f%% %8d %-11s %10ld %9.2f%% %12.0f %10.2f\n", fractions[f] * 100, ways,
+                   coalesce ? "coalescido" : "normal", tlb->misses, 100.0 * tlb->misses / tlb->accesses,
+                   samples ? (double)reach / samples * PAGE_SIZE / 1024 : 0.0, tlb_amat(tlb));
+            tlb_destroy(tlb);
+        }
+        page_table_destroy(pt);
+    }
+}
+
+/**
+ * Función: run_lookup_benchmark
+ * Descripción: Mide búsquedas por segundo en el TLB con comparación escalar y
+ *              con AVX2, para 8 y 16 vías con 1024 entradas. El TLB se llena
+ *              antes reproduciendo la traza, y después se buscan las mismas
+ *              páginas ya decodificadas con las dos implementaciones, que
+ *              deben dar los mismos aciertos.
+ */
+void run_lookup_benchmark(const Trace *trace) {
+    const int ways_list[] = {8, 16};
+    unsigned int *vpns = malloc(trace->length * sizeof(unsigned int));
+    PageTable *pt = page_table_build(trace, 0.5, 0xD1B54A32D192ED03ULL);
+
+    for (long i = 0; i < trace->length; i++) vpns[i] = virtual_page_number(decompose_address(trace->addresses[i]));
+    printf("Búsquedas en el TLB sobre %ld páginas de la traza (1024 entradas)\n", trace->length);
+    printf(" %6s %16s %16s %9s %10s\n", "Vías", "Escalar (M/s)", "AVX2 (M/s)", "Mejora", "Aciertos");
+    for (int w = 0; w < 2; w++) {
+        int ways = ways_list[w];
+        Tlb *tlb = tlb_create(1024 / ways, ways, 0);
+        for (long i = 0; i < trace->length; i++) tlb_translate(tlb, pt, vpns[i]);
+
+        double rates[2];
+        long hits[2];
+        for (int simd = 0; simd <= tlb->use_simd; simd++) {
+            struct timespec start, end;
+            hits[simd] = 0;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            for (long i = 0; i < trace->length; i++) {
+#if defined(__x86_64__)
+                hits[simd] += (simd ? tlb_lookup_avx2(tlb, vpns[i], 0) : tlb_lookup_scalar(tlb, vpns[i], 0)) >= 0;
+#else
+                hits[simd] += tlb_lookup_scalar(tlb, vpns[i], 0) >= 0;
+#endif
+            }
+            clock_gettime(CLOCK_MONOTONIC, &end);
+            rates[simd] = trace->length / ((end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9) / 1e6;
+        }
+        if (tlb->use_simd) {
+            printf(" %5d %16.1f %16.1f %8.2fx %10s\n", ways, rates[0], rates[1], rates[1] / rates[0],
+                   hits[0] == hits[1] ? "iguales" : "DISTINTOS");
+        } else {
+            // Sin AVX2 (otra arquitectura o CPU antigua) sólo se mide la búsqueda escalar
+            printf(" %5d %16.1f %16s %9s %10s\n", ways, rates[0], "-", "-", "-");
+        }
+        tlb_destroy(tlb);
+    }
+    page_table_destroy(pt);
+    free(vpns);
+}
+
+/* ------------------------------------------------------------------------
+ * Simulación de todas las asociatividades en una pasada
+ * ------------------------------------------------------------------------
+ * Con reemplazo LRU, un TLB de A vías acierta si y sólo si, desde la última
+ * referencia a la página, se han referenciado menos de A páginas distintas
+ * de su mismo conjunto (propiedad de inclusión de Mattson, que Hill y Smith
+ * extienden a todos los números de conjuntos). Por eso basta, para cada
+ * número de conjuntos 2^i, una pila LRU por conjunto truncada a
+ * ALLASSOC_MAX_WAYS páginas: la posición de la página en su pila es su
+ * distancia, y del histograma de distancias salen los fallos de cualquier
+ * número de vías. Una pasada de la traza cubre así todas las geometrías.
+ * (La pila única de Hill y Smith obliga a recorrer miles de páginas en cada
+ * fallo de la configuración más grande; las pilas truncadas acotan el
+ * trabajo por referencia a (ALLASSOC_MAX_SET_BITS + 1) búsquedas de 16
+ * etiquetas.)
+ */
+
+#define ALLASSOC_MAX_SET_BITS 8    // Hasta 256 conjuntos
+#define ALLASSOC_MAX_WAYS 16       // Hasta 16 vías
+
+typedef struct {
+    uint32_t *stacks[ALLASSOC_MAX_SET_BITS + 1]; // stacks[i][set * 16 + k]: k-ésima página más reciente del conjunto
+    long hist[ALLASSOC_MAX_SET_BITS + 1][ALLASSOC_MAX_WAYS + 1]; // [bits de conjunto][distancia]; la última cubeta
+                                                                  // acumula distancias >= ALLASSOC_MAX_WAYS y primeros accesos
+    long accesses;
+} AllAssocSim;
+
+AllAssocSim *allassoc_create(void) {
+    AllAssocSim *sim = calloc(1, sizeof(AllAssocSim));
+    for (int bits = 0; bits <= ALLASSOC_MAX_SET_BITS; bits++) {
+        size_t entries = ((size_t)1 << bits) * ALLASSOC_MAX_WAYS;
+        sim->stacks[bits] = aligned_alloc(64, entries * sizeof(uint32_t));
+        for (size_t i = 0; i < entries; i++) sim->stacks[bits][i] = TLB_INVALID_TAG;
+    }
+    return sim;
+}
+
+void allassoc_destroy(AllAssocSim *sim) {
+    for (int bits = 0; bits <= ALLASSOC_MAX_SET_BITS; bits++) free(sim->stacks[bits]);
+    free(sim);
+}
+
+/**
+ * Función: allassoc_access
+ * Descripción: Procesa una referencia: para cada número de conjuntos busca la
+ *              página en la pila de su conjunto, anota su distancia (o
+ *              ALLASSOC_MAX_WAYS si no está) y la sube a la cima.
+ */
+void allassoc_access(AllAssocSim *sim, unsigned int vpn) {
+    sim->accesses++;
+    for (int bits = 0; bits <= ALLASSOC_MAX_SET_BITS; bits++) {
+        uint32_t *stack = sim->stacks[bits] + (vpn & ((1u << bits) - 1)) * ALLASSOC_MAX_WAYS;
+        int distance = 0;
+        while (distance < ALLASSOC_MAX_WAYS && stack[distance] != vpn) distance++;
+        sim->hist[bits][distance]++;
+        memmove(stack + 1, stack, (distance < ALLASSOC_MAX_WAYS ? distance : ALLASSOC_MAX_WAYS - 1) * sizeof(uint32_t));
+        stack[0] = vpn;
+    }
+}
+
+/**
+ * Función: allassoc_misses
+ * Descripción: Fallos de un TLB LRU de 2^set_bits conjuntos y 'ways' vías.
+ */
+long allassoc_misses(const AllAssocSim *sim, int set_bits, int ways) {
+    long misses = 0;
+    for (int d = ways; d <= ALLASSOC_MAX_WAYS; d++) misses += sim->hist[set_bits][d];
+    return misses;
+}
+
+/**
+ * Función: run_allassoc_sweep
+ * Descripción: Obtiene en una sola pasada los fallos de todos los TLB de 1 a
+ *              256 conjuntos y de 1 a 16 vías, y los compara con simular por
+ *              separado cada configuración de la tabla (que también sirve de
+ *              comprobación).
+ */
+void run_allassoc_sweep(const Trace *trace) {
+    const int ways_list[] = {1, 2, 4, 8, 16};
+    PageTable *pt = page_table_build(trace, 0.5, 0xD1B54A32D192ED03ULL);
+    unsigned int *vpns = malloc(trace->length * sizeof(unsigned int));
+    AllAssocSim *sim = allassoc_create();
+    struct timespec start, end;
+
+    for (long i = 0; i < trace->length; i++) vpns[i] = virtual_page_number(decompose_address(trace->addresses[i]));
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < trace->length; i++) allassoc_access(sim, vpns[i]);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double single_pass = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+
+    printf("Tasa de fallos (%%) de TLB LRU, %ld accesos, una sola pasada\n", trace->length);
+    printf(" %10s", "Conjuntos");
+    for (int w = 0; w < 5; w++) printf(" %6d v", ways_list[w]);
+    printf("\n");
+    for (int bits = 0; bits <= ALLASSOC_MAX_SET_BITS; bits++) {
+        printf(" %10d", 1 << bits);
+        for (int w = 0; w < 5; w++) printf(" %8.2f", 100.0 * allassoc_misses(sim, bits, ways_list[w]) / trace->length);
+        printf("\n");
+    }
+
+    // Comprobación: cada configuración por separado con el simulador de TLB
+    int configs = 0, mismatches = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int bits = 0; bits <= ALLASSOC_MAX_SET_BITS; bits++) {
+        for (int w = 0; w < 5; w++) {
+            Tlb *tlb = tlb_create(1 << bits, ways_list[w], 0);
+            for (long i = 0; i < trace->length; i++) tlb_translate(tlb, pt, vpns[i]);
+            if (tlb->misses != allassoc_misses(sim, bits, ways_list[w])) mismatches++;
+            configs++;
+            tlb_destroy(tlb);
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double separate = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+
+    printf("Una pasada: %.2f s; %d pasadas separadas: %.2f s (%.1fx); configuraciones distintas: %d\n",
+           single_pass, configs, separate, separate / single_pass, mismatches);
+    allassoc_destroy(sim);
+    page_table_destroy(pt);
+    free(vpns);
+}
+
+/* ------------------------------------------------------------------------
+ * Torneo de políticas de reemplazo
+ * ------------------------------------------------------------------------
+ * Para comparar varias políticas, la traza se decodifica una sola vez por
+ * bloques (decompose_address y número de página) y cada bloque decodificado
+ * se reparte, de sólo lectura, a un hilo por política. Con dos búferes, el
+ * hilo principal decodifica el bloque siguiente mientras los demás simulan
+ * el actual; una barrera separa cada ronda.
+ */
+
+#define TOURNAMENT_BLOCK 65536     // Accesos por bloque decodificado
+#define TOURNAMENT_MAX_ENTRANTS 16 // Máximo de instancias compitiendo
+
+// Estado compartido del torneo
+typedef struct {
+    const Trace *trace;
+    PageTable *pt;
+    unsigned int *blocks[2];        // Doble búfer de páginas decodificadas
+    long block_length[2];           // Accesos del bloque; 0 indica el final de la traza
+    pthread_barrier_t barrier;
+} Tournament;
+
+// Una instancia que compite: un TLB con su política y su hilo
+typedef struct {
+    Tournament *tournament;
+    Tlb *tlb;
+    const char *name;
+} TournamentEntrant;
+
+/**
+ * Función: decode_block
+ * Descripción: Decodifica los accesos [first, first + length) de la traza en números de página.
+ */
+static void decode_block(const Trace *trace, long first, long length, unsigned int *vpns) {
+    for (long i = 0; i < length; i++) vpns[i] = virtual_page_number(decompose_address(trace->addresses[first + i]));
+}
+
+static void *tournament_thread(void *arg) {
+    TournamentEntrant *entrant = arg;
+    Tournament *t = entrant->tournament;
+    for (int round = 0;; round++) {
+        pthread_barrier_wait(&t->barrier); // El bloque de esta ronda está decodificado
+        const unsigned int *vpns = t->blocks[round % 2];
+        long length = t->block_length[round % 2];
+        if (length == 0) break;
+        for (long i = 0; i < length; i++) tlb_translate(entrant->tlb, t->pt, vpns[i]);
+    }
+    return NULL;
+}
+
+/**
+ * Función: run_tournament
+ * Descripción: Simula en una sola pasada de la traza varias políticas de
+ *              reemplazo (LRU, FIFO, aleatoria y reloj) en dos tamaños de TLB,
+ *              cada una en su hilo, y compara el tiempo con simularlas una
+ *              detrás de otra decodificando la traza en cada una.
+ */
+void run_tournament(const Trace *trace) {
+    const TlbReplacement policies[] = {REPLACE_LRU, REPLACE_FIFO, REPLACE_RANDOM, REPLACE_CLOCK};
+    const char *names[] = {"LRU", "FIFO", "aleatoria", "reloj"};
+    const int geometries[][2] = {{16, 4}, {64, 8}};
+    TournamentEntrant entrants[TOURNAMENT_MAX_ENTRANTS];
+    pthread_t threads[TOURNAMENT_MAX_ENTRANTS];
+    Tournament t = {.trace = trace, .pt = page_table_build(trace, 0.5, 0xD1B54A32D192ED03ULL)};
+    int num_entrants = 0;
+    struct timespec start, end;
+
+    for (int g = 0; g < 2; g++) {
+        for (int p = 0; p < 4; p++) {
+            entrants[num_entrants].tournament = &t;
+            entrants[num_entrants].tlb = tlb_create(geometries[g][0], geometries[g][1], 0);
+            tlb_set_replacement(entrants[num_entrants].tlb, policies[p]);
+            entrants[num_entrants].name = names[p];
+            num_entrants++;
+        }
+    }
+
+    // Torneo: una decodificación, todas las políticas a la vez
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    t.blocks[0] = malloc(TOURNAMENT_BLOCK * sizeof(unsigned int));
+    t.blocks[1] = malloc(TOURNAMENT_BLOCK * sizeof(unsigned int));
+    pthread_barrier_init(&t.barrier, NULL, num_entrants + 1);
+    for (int i = 0; i < num_entrants; i++) pthread_create(&threads[i], NULL, tournament_thread, &entrants[i]);
+    long first = 0;
+    t.block_length[0] = trace->length < TOURNAMENT_BLOCK ? trace->length : TOURNAMENT_BLOCK;
+    decode_block(trace, 0, t.block_length[0], t.blocks[0]);
+    for (int round = 0;; round++) {
+        pthread_barrier_wait(&t.barrier); // Los hilos empiezan con el bloque round
+        if (t.block_length[round % 2] == 0) break;
+        first += t.block_length[round % 2];
+        long next = trace->length - first < TOURNAMENT_BLOCK ? trace->length - first : TOURNAMENT_BLOCK;
+        // Todos los hilos pasaron la barrera, así que terminaron la ronda anterior y su búfer está libre
+        decode_block(trace, first, next, t.blocks[(round + 1) % 2]);
+        t.block_length[(round + 1) % 2] = next;
+    }
+    for (int i = 0; i < num_entrants; i++) pthread_join(threads[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double tournament_seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    pthread_barrier_destroy(&t.barrier);
+
+    // Referencia: cada política por separado, decodificando la traza cada vez
+    long reference_misses[TOURNAMENT_MAX_ENTRANTS];
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < num_entrants; i++) {
+        Tlb *tlb = tlb_create(entrants[i].tlb->sets, entrants[i].tlb->ways, 0);
+        tlb_set_replacement(tlb, entrants[i].tlb->replacement);
+        for (long a = 0; a < trace->length; a += TOURNAMENT_BLOCK) {
+            long length = trace->length - a < TOURNAMENT_BLOCK ? trace->length - a : TOURNAMENT_BLOCK;
+            decode_block(trace, a, length, t.blocks[0]);
+            for (long k = 0; k < length; k++) tlb_translate(tlb, t.pt, t.blocks[0][k]);
+        }
+        reference_misses[i] = tlb->misses;
+        tlb_destroy(tlb);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double sequential_seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+
+    printf("Torneo de %d políticas sobre %ld accesos (bloques de %d)\n", num_entrants, trace->length, TOURNAMENT_BLOCK);
+    printf(" %-11s %9s %10s %10s %10s\n", "Política", "Entradas", "Fallos", "Tasa", "AMAT ns");
+    for (int i = 0; i < num_entrants; i++) {
+        Tlb *tlb = entrants[i].tlb;
+        printf(" %-10s %4dx%-4d %10ld %9.2f%% %10.2f%s\n", entrants[i].name, tlb->sets, tlb->ways, tlb->misses,
+               100.0 * tlb->misses / tlb->accesses, tlb_amat(tlb),
+               tlb->misses == reference_misses[i] ? "" : "  (distinto de la simulación por separado)");
+        tlb_destroy(tlb);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long a = 0; a < trace->length; a += TOURNAMENT_BLOCK) {
+        decode_block(trace, a, trace->length - a < TOURNAMENT_BLOCK ? trace->length - a : TOURNAMENT_BLOCK, t.blocks[0]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double decode_seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    printf("Torneo: %.2f s; por separado: %.2f s (%.2fx); decodificar la traza cuesta %.3f s por pasada\n",
+           tournament_seconds, sequential_seconds, sequential_seconds / tournament_seconds, decode_seconds);
+    free(t.blocks[0]);
+    free(t.blocks[1]);
+    page_table_destroy(t.pt);
+}
+
+/* ------------------------------------------------------------------------
+ * Prebúsqueda de traducciones
+ * ------------------------------------------------------------------------
+ * En cada fallo del TLB el prebuscador predice otras páginas que se van a
+ * usar y recorre la tabla de páginas para ellas, dejando las traducciones en
+ * un búfer de prebúsqueda pequeño y totalmente asociativo que se consulta a
+ * la vez que el TLB. Un acierto en el búfer pasa la entrada al TLB sin
+ * recorrido y cuenta como prebúsqueda útil. Predictores (Kandiraju y
+ * Sivasubramaniam):
+ *   - Secuencial: la página siguiente.
+ *   - Por instrucción (stride): una tabla indexada por la instrucción guarda
+ *     la última página y el paso; con dos pasos iguales seguidos se prebusca
+ *     la página + paso.
+ *   - Por distancias: una tabla indexada por la distancia entre los dos
+ *     últimos fallos guarda las distancias que la siguieron, y se prebuscan
+ *     las páginas a esas distancias del fallo actual.
+ */
+
+#define PREFETCH_BUFFER_ENTRIES 16   // Entradas del búfer de prebúsqueda (FIFO)
+#define STRIDE_TABLE_ENTRIES 64      // Entradas de la tabla por instrucción
+#define DISTANCE_TABLE_ENTRIES 256   // Entradas de la tabla de distancias
+#define DISTANCE_PREDICTIONS 2       // Distancias guardadas por entrada
+
+typedef enum {
+    PREFETCH_NONE,
+    PREFETCH_SEQUENTIAL,
+    PREFETCH_STRIDE,
+    PREFETCH_DISTANCE
+} PrefetchKind;
+
+typedef struct {
+    unsigned int pc;
+    unsigned int last_vpn;
+    int stride;
+    int confident;          // 1 si los dos últimos pasos coincidieron
+} StrideEntry;
+
+typedef struct {
+    int distance;           // Distancia que indexa la entrada
+    int next[DISTANCE_PREDICTIONS]; // Distancias que la siguieron, la más reciente primero
+    int valid;
+} DistanceEntry;
+
+typedef struct {
+    PrefetchKind kind;
+    unsigned int buffer_vpn[PREFETCH_BUFFER_ENTRIES];
+    int buffer_frame[PREFETCH_BUFFER_ENTRIES];
+    int buffer_next;        // Siguiente posición a sustituir
+    StrideEntry strides[STRIDE_TABLE_ENTRIES];
+    DistanceEntry distances[DISTANCE_TABLE_ENTRIES];
+    unsigned int last_miss;
+    int last_distance;
+    long issued;            // Prebúsquedas con recorrido de la tabla
+    long useful;            // Aciertos en el búfer
+} TlbPrefetcher;
+
+TlbPrefetcher *prefetcher_create(PrefetchKind kind) {
+    TlbPrefetcher *pf = calloc(1, sizeof(TlbPrefetcher));
+    pf->kind = kind;
+    for (int i = 0; i < PREFETCH_BUFFER_ENTRIES; i++) pf->buffer_vpn[i] = TLB_INVALID_TAG;
+    return pf;
+}
+
+/**
+ * Función: prefetch_page
+ * Descripción: Prebusca una página si no está ya en el TLB ni en el búfer:
+ *              recorre la tabla de páginas y la guarda en el búfer.
+ */
+static void prefetch_page(TlbPrefetcher *pf, Tlb *tlb, const PageTable *pt, long vpn) {
+    if (vpn < 0 || vpn >= (1 << 20) || tlb_contains(tlb, vpn)) return;
+    for (int i = 0; i < PREFETCH_BUFFER_ENTRIES; i++) {
+        if (pf->buffer_vpn[i] == vpn) return;
+    }
+    int frame = page_table_walk(pt, vpn);
+    tlb->walks++;
+    pf->issued++;
+    if (frame < 0) return;
+    pf->buffer_vpn[pf->buffer_next] = vpn;
+    pf->buffer_frame[pf->buffer_next] = frame;
+    pf->buffer_next = (pf->buffer_next + 1) % PREFETCH_BUFFER_ENTRIES;
+}
+
+/**
+ * Función: prefetch_on_miss
+ * Descripción: Entrena el predictor con un fallo del TLB (o un acierto en el
+ *              búfer, que habría sido un fallo) y lanza sus prebúsquedas.
+ */
+static void prefetch_on_miss(TlbPrefetcher *pf, Tlb *tlb, const PageTable *pt, unsigned int vpn, unsigned int pc) {
+    switch (pf->kind) {
+    case PREFETCH_SEQUENTIAL:
+        prefetch_page(pf, tlb, pt, (long)vpn + 1);
+        break;
+    case PREFETCH_STRIDE: {
+        StrideEntry *e = &pf->strides[(pc >> 2) % STRIDE_TABLE_ENTRIES];
+        if (e->pc != pc) {
+            *e = (StrideEntry){pc, vpn, 0, 0};
+            break;
+        }
+        int stride = (int)vpn - (int)e->last_vpn;
+        e->confident = stride != 0 && stride == e->stride;
+        e->stride = stride;
+        e->last_vpn = vpn;
+        if (e->confident) prefetch_page(pf, tlb, pt, (long)vpn + stride);
+        break;
+    }
+    case PREFETCH_DISTANCE: {
+        int distance = (int)vpn - (int)pf->last_miss;
+        // La distancia anterior aprende que le siguió esta
+        DistanceEntry *prev = &pf->distances[(unsigned)pf->last_distance % DISTANCE_TABLE_ENTRIES];
+        if (!prev->valid || prev->distance != pf->last_distance) {
+            *prev = (DistanceEntry){pf->last_distance, {distance, distance}, 1};
+        } else if (prev->next[0] != distance) {
+            prev->next[1] = prev->next[0];
+            prev->next[0] = distance;
+        }
+        DistanceEntry *e = &pf->distances[(unsigned)distance % DISTANCE_TABLE_ENTRIES];
+        if (e->valid && e->distance == distance) {
+            for (int k = 0; k < DISTANCE_PREDICTIONS; k++) {
+                if (k == 0 || e->next[k] != e->next[0]) prefetch_page(pf, tlb, pt, (long)vpn + e->next[k]);
+            }
+        }
+        pf->last_distance = distance;
+        pf->last_miss = vpn;
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/**
+ * Función: tlb_translate_prefetch
+ * Descripción: Como tlb_translate, consultando también el búfer de
+ *              prebúsqueda y entrenando al prebuscador.
+ * Parámetros:
+ *   - pc: instrucción que hace el acceso (0 si la traza no la incluye).
+ */
+int tlb_translate_prefetch(Tlb *tlb, TlbPrefetcher *pf, const PageTable *pt, unsigned int vpn, unsigned int pc) {
+    int frame = tlb_probe(tlb, vpn);
+    if (frame >= 0) return frame;
+
+    for (int i = 0; i < PREFETCH_BUFFER_ENTRIES; i++) {
+        if (pf->buffer_vpn[i] == vpn) {
+            frame = pf->buffer_frame[i];
+            pf->buffer_vpn[i] = TLB_INVALID_TAG;
+            pf->useful++;
+            tlb_fill(tlb, pt, vpn, frame, NULL);
+            prefetch_on_miss(pf, tlb, pt, vpn, pc);
+            return frame;
+        }
+    }
+    tlb->misses++;
+    tlb->walks++;
+    frame = page_table_walk(pt, vpn);
+    if (frame >= 0) tlb_fill(tlb, pt, vpn, frame, NULL);
+    prefetch_on_miss(pf, tlb, pt, vpn, pc);
+    return frame;
+}
+
+/**
+ * Función: run_prefetch_comparison
+ * Descripción: Reproduce la traza sin prebúsqueda y con cada predictor, e
+ *              informa de los fallos, la precisión (prebúsquedas usadas /
+ *              lanzadas), la cobertura (fallos evitados / fallos sin
+ *              prebúsqueda) y los recorridos de la tabla añadidos.
+ */
+void run_prefetch_comparison(const Trace *trace) {
+    const char *names[] = {"ninguno", "secuencial", "por instrucción", "distancias"};
+    PageTable *pt = page_table_build(trace, 0.5, 0xD1B54A32D192ED03ULL);
+    long baseline_misses = 0, baseline_walks = 0;
+
+    printf("Prebúsqueda en un TLB de 16x4 con búfer de %d entradas, %ld accesos%s\n", PREFETCH_BUFFER_ENTRIES,
+           trace->length, trace->pcs ? "" : " (la traza no tiene instrucciones: stride con pc = 0)");
+    printf(" %-16s %10s %9s %11s %10s %10s %11s %10s\n", "Prebuscador", "Fallos", "Tasa", "Prebúsq.", "Precisión",
+           "Cobertura", "Recorridos", "Añadidos");
+    for (int kind = PREFETCH_NONE; kind <= PREFETCH_DISTANCE; kind++) {
+        Tlb *tlb = tlb_create(16, 4, 0);
+        TlbPrefetcher *pf = prefetcher_create(kind);
+        for (long i = 0; i < trace->length; i++) {
+            unsigned int vpn = virtual_page_number(decompose_address(trace->addresses[i]));
+            tlb_translate_prefetch(tlb, pf, pt, vpn, trace->pcs ? trace->pcs[i] : 0);
+        }
+        if (kind == PREFETCH_NONE) {
+            baseline_misses = tlb->misses;
+            baseline_walks = tlb->walks;
+        }
+        printf(" %-16s %10ld %8.2f%% %10ld %9.1f%% %9.1f%% %11ld %9.1f%%\n", names[kind], tlb->misses,
+               100.0 * tlb->misses / tlb->accesses, pf->issued, pf->issued ? 100.0 * pf->useful / pf->issued : 0.0,
+               baseline_misses ? 100.0 * (baseline_misses - tlb->misses) / baseline_misses : 0.0, tlb->walks,
+               baseline_walks ? 100.0 * (tlb->walks - baseline_walks) / baseline_walks : 0.0);
+        free(pf);
+        tlb_destroy(tlb);
+    }
+    page_table_destroy(pt);
+}
+
+/* ------------------------------------------------------------------------
+ * TLB de víctimas y fallos por conflicto
+ * ------------------------------------------------------------------------
+ * Un TLB de víctimas es un TLB pequeño y totalmente asociativo que recoge
+ * las entradas expulsadas del TLB principal. Si un fallo del principal
+ * acierta en él, las dos entradas se intercambian sin recorrer la tabla de
+ * páginas: así se recuperan las páginas que sólo salieron por chocar en un
+ * conjunto. Los fallos se clasifican con el modelo de las tres C: los
+ * obligatorios son primeras referencias, los de capacidad los que añade un
+ * TLB totalmente asociativo LRU del mismo número de entradas y los de
+ * conflicto el resto. Las organizaciones con víctimas tienen 64 +
+ * VICTIM_TLB_ENTRIES entradas y se comparan con una referencia de ese tamaño.
+ */
+
+#define VICTIM_TLB_ENTRIES 8       // Entradas del TLB de víctimas
+
+/**
+ * Función: tlb_translate_victim
+ * Descripción: Traduce con un TLB principal respaldado por un TLB de víctimas.
+ * Retorno:
+ *   - Marco de la página, o -1 si no está asignada.
+ */
+int tlb_translate_victim(Tlb *tlb, Tlb *victim, const PageTable *pt, unsigned int vpn) {
+    int frame = tlb_probe(tlb, vpn);
+    if (frame >= 0) return frame;
+
+    int evicted_frame;
+    int victim_slot = tlb_lookup(victim, vpn, 0);
+    if (victim_slot >= 0) {
+        // Intercambio: la entrada vuelve al principal y la que sale ocupa su hueco en el de víctimas
+        frame = victim->frames[victim_slot];
+        victim->tags[victim_slot] = TLB_INVALID_TAG;
+    } else {
+        tlb->misses++;
+        tlb->walks++;
+        frame = page_table_walk(pt, vpn);
+        if (frame < 0) return -1;
+    }
+    uint32_t evicted = tlb_fill(tlb, pt, vpn, frame, &evicted_frame);
+    if (evicted != TLB_INVALID_TAG) {
+        victim->clock++;
+        tlb_fill(victim, pt, evicted, evicted_frame, NULL);
+    }
+    return frame;
+}
+
+/**
+ * Función: padded_width
+ * Descripción: Ancho para printf("%-*s") con el que un texto UTF-8 ocupa
+ *              'width' columnas: printf cuenta bytes, no caracteres.
+ */
+static int padded_width(const char *text, int width) {
+    for (; *text; text++) {
+        if ((*text & 0xC0) == 0x80) width++;
+    }
+    return width;
+}
+
+/**
+ * Función: conflict_table
+ * Descripción: Compara organizaciones de TLB de 64 entradas (directo,
+ *              asociativo de 2 y 4 vías, con TLB de víctimas y sesgado) sobre
+ *              una traza, separando los fallos obligatorios, de capacidad y de
+ *              conflicto.
+ */
+static void conflict_table(const Trace *trace, const char *title) {
+    struct {
+        const char *name;
+        int sets, ways, skewed, victim;
+    } configs[] = {
+        {"directo", 64, 1, 0, 0},
+        {"2 vías", 32, 2, 0, 0},
+        {"4 vías", 16, 4, 0, 0},
+        {"directo+víctimas", 64, 1, 0, 1},
+        {"4 vías+víctimas", 16, 4, 0, 1},
+        {"2 vías sesgado", 32, 2, 1, 0},
+        {"4 vías sesgado", 16, 4, 1, 0},
+    };
+    const int num_configs = sizeof(configs) / sizeof(configs[0]);
+    PageTable *pt = page_table_build(trace, 0.5, 0xD1B54A32D192ED03ULL);
+    unsigned int *vpns = malloc(trace->length * sizeof(unsigned int));
+    uint64_t *seen = calloc((1 << 20) / 64, sizeof(uint64_t));
+    long compulsory = 0;
+
+    for (long i = 0; i < trace->length; i++) {
+        vpns[i] = virtual_page_number(decompose_address(trace->addresses[i]));
+        if (!(seen[vpns[i] / 64] >> (vpns[i] % 64) & 1)) compulsory++;
+        seen[vpns[i] / 64] |= 1ULL << (vpns[i] % 64);
+    }
+    free(seen);
+
+    // Referencias sin conflictos: totalmente asociativo LRU con las entradas de cada organización
+    long fully_associative[2];
+    for (int v = 0; v < 2; v++) {
+        Tlb *full = tlb_create(1, 64 + v * VICTIM_TLB_ENTRIES, 0);
+        for (long i = 0; i < trace->length; i++) tlb_translate(full, pt, vpns[i]);
+        fully_associative[v] = full->misses;
+        tlb_destroy(full);
+    }
+
+    printf("%s: %ld accesos\n", title, trace->length);
+    printf(" Obligatorios: %ld; capacidad: %ld (totalmente asociativo LRU: %ld)\n",
+           compulsory, fully_associative[0] - compulsory, fully_associative[0]);
+    printf(" Con víctimas (%d entradas): capacidad: %ld (totalmente asociativo LRU: %ld)\n",
+           64 + VICTIM_TLB_ENTRIES, fully_associative[1] - compulsory, fully_associative[1]);
+    printf(" %-*s %10s %9s %12s %12s\n", padded_width("Organización", 20), "Organización",
+           "Fallos", "Tasa", "Conflicto", "% fallos");
+    for (int c = 0; c < num_configs; c++) {
+        Tlb *tlb = tlb_create(configs[c].sets, configs[c].ways, 0);
+        Tlb *victim = tlb_create(1, VICTIM_TLB_ENTRIES, 0);
+        if (configs[c].skewed) tlb_set_skewed(tlb);
+        for (long i = 0; i < trace->length; i++) {
+            if (configs[c].victim) {
+                tlb_translate_victim(tlb, victim, pt, vpns[i]);
+            } else {
+                tlb_translate(tlb, pt, vpns[i]);
+            }
+        }
+        long conflicts = tlb->misses - fully_associative[configs[c].victim];
+        printf(" %-*s %10ld %8.2f%% %12ld %11.1f%%\n", padded_width(configs[c].name, 20), configs[c].name,
+               tlb->misses, tlb->accesses ? 100.0 * tlb->misses / tlb->accesses : 0.0, conflicts,
+               tlb->misses ? 100.0 * conflicts / tlb->misses : 0.0);
+        tlb_destroy(victim);
+        tlb_destroy(tlb);
+    }
+    page_table_destroy(pt);
+    free(vpns);
+}
+
+/**
+ * Función: run_conflict_comparison
+ * Descripción: Tabla de fallos por conflicto para la traza dada y para un
+ *              recorrido por columnas de una matriz cuyas filas miden 16
+ *              páginas: las 64 páginas del recorrido caben en el TLB, pero con
+ *              índice por bits bajos todas caen en el mismo conjunto.
+ */
+void run_conflict_comparison(const Trace *trace) {
+    Trace columns = {malloc(trace->length / 4 * sizeof(unsigned int)), NULL, trace->length / 4};
+
+    for (long i = 0; i < columns.length; i++) {
+        long row = i % 64, column = i / (64 * 8) % 16; // Ocho pasadas por columna
+        columns.addresses[i] = 0x50000000u + (unsigned int)((row * 16 + column) * PAGE_SIZE + (i % 8) * 8);
+    }
+    conflict_table(trace, "Traza");
+    printf("\n");
+    conflict_table(&columns, "Recorrido por columnas (filas de 16 páginas)");
+    trace_free(&columns);
+}
+
+/* ------------------------------------------------------------------------
+ * TLB no bloqueante
+ * ------------------------------------------------------------------------
+ * calculate_memory_access_time suma las latencias como si cada acceso
+ * esperase a que termine el anterior. Un procesador fuera de orden tiene
+ * en vuelo una ventana de accesos independientes: el TLB sigue atendiendo
+ * aciertos mientras se recorre la tabla para un fallo (acierto bajo fallo)
+ * y sus registros de fallos pendientes (MSHR) permiten varios recorridos a
+ * la vez. Un fallo a una página que ya se está recorriendo se une al MSHR
+ * de ese recorrido. El recorrido lee los niveles de la tabla uno tras otro,
+ * cada uno con la parte de page_walk_time que le toca en el modelo, y la
+ * traducción entra en el TLB cuando termina. Las lecturas de datos no
+ * compiten entre sí (no se modela el ancho de banda de la DRAM).
+ */
+
+#define PAGE_TABLE_LEVELS 3       // Niveles que lee un recorrido de la tabla de páginas
+#define MAX_MSHRS 16              // Máximo de recorridos simultáneos configurables
+#define MLP_WINDOW 16             // Accesos independientes en vuelo
+
+// Registro de un fallo del TLB pendiente
+typedef struct {
+    unsigned int vpn;
+    double ready;           // Instante en que termina el recorrido (ns)
+    int busy;
+} Mshr;
+
+// Resultado de una simulación con tiempos
+typedef struct {
+    long accesses;
+    long misses;            // Fallos que lanzan un recorrido
+    long merged;            // Fallos unidos a un recorrido en curso
+    long mshr_stalls;       // Fallos que esperaron a que se liberase un MSHR
+    double elapsed;         // ns desde el primer acceso hasta que llega el último dato
+} NonBlockingStats;
+
+/**
+ * Función: page_walk_level_time
+ * Descripción: Tiempo de leer un nivel de la tabla de páginas: el recorrido
+ *              de calculate_memory_access_time repartido entre sus niveles.
+ */
+double page_walk_level_time(void) {
+    return memory_timing.page_walk_time / PAGE_TABLE_LEVELS;
+}
+
+/**
+ * Función: mshr_retire
+ * Descripción: Libera los MSHR cuyo recorrido ha terminado en 'now' y guarda
+ *              su traducción en el TLB.
+ */
+static void mshr_retire(Mshr *mshrs, int num_mshrs, Tlb *tlb, const PageTable *pt, double now) {
+    for (int m = 0; m < num_mshrs; m++) {
+        if (!mshrs[m].busy || mshrs[m].ready > now) continue;
+        int frame = page_table_walk(pt, mshrs[m].vpn);
+        if (frame >= 0) tlb_fill(tlb, pt, mshrs[m].vpn, frame, NULL);
+        mshrs[m].busy = 0;
+    }
+}
+
+/**
+ * Función: simulate_nonblocking
+ * Descripción: Reproduce una secuencia de páginas con tiempos. Los accesos
+ *              se emiten en orden, cada uno en cuanto hay sitio en la
+ *              ventana, y ocupan su hueco hasta que llega el dato (traducción
+ *              más memory_access_time).
+ * Parámetros:
+ *   - num_mshrs: recorridos simultáneos (1..MAX_MSHRS).
+ *   - window: accesos en vuelo; con 1 los accesos van en serie.
+ *   - blocking: 1 si un fallo bloquea el TLB, también para los aciertos,
+ *     hasta que termina su recorrido.
+ */
+NonBlockingStats simulate_nonblocking(const unsigned int *vpns, long length, const PageTable *pt,
+                                      int num_mshrs, int window, int blocking) {
+    NonBlockingStats stats = {length, 0, 0, 0, 0.0};
+    Tlb *tlb = tlb_create(16, 4, 0);
+    Mshr mshrs[MAX_MSHRS] = {{0}};
+    double *done = calloc(window, sizeof(double)); // Llegada del dato de cada hueco de la ventana
+    double now = 0.0, blocked_until = 0.0;
+
+    for (long i = 0; i < length; i++) {
+        double translated;
+        if (done[i % window] > now) now = done[i % window];
+        if (blocking && blocked_until > now) now = blocked_until;
+        mshr_retire(mshrs, num_mshrs, tlb, pt, now);
+
+        if (tlb_probe(tlb, vpns[i]) >= 0) {
+            translated = now + memory_timing.tlb_hit_time;
+        } else {
+            int pending = -1, free_slot = -1;
+            for (int m = 0; m < num_mshrs; m++) {
+                if (mshrs[m].busy && mshrs[m].vpn == vpns[i]) pending = m;
+                else if (!mshrs[m].busy) free_slot = m;
+            }
+            if (pending >= 0) {
+                stats.merged++;
+                translated = mshrs[pending].ready;
+            } else {
+                if (free_slot < 0) {
+                    // Todos los MSHR ocupados: la emisión espera al primer recorrido que termine
+                    double earliest = mshrs[0].ready;
+                    for (int m = 1; m < num_mshrs; m++) {
+                        if (mshrs[m].ready < earliest) earliest = mshrs[m].ready;
+                    }
+                    now = earliest;
+                    stats.mshr_stalls++;
+                    mshr_retire(mshrs, num_mshrs, tlb, pt, now);
+                    for (int m = 0; m < num_mshrs; m++) {
+                        if (!mshrs[m].busy) free_slot = m;
+                    }
+                }
+                translated = now;
+                for (int level = 0; level < PAGE_TABLE_LEVELS; level++) translated += page_walk_level_time();
+                mshrs[free_slot] = (Mshr){vpns[i], translated, 1};
+                stats.misses++;
+                if (blocking) blocked_until = translated;
+            }
+        }
+        done[i % window] = translated + memory_timing.memory_access_time;
+        if (done[i % window] > stats.elapsed) stats.elapsed = done[i % window];
+    }
+    free(done);
+    tlb_destroy(tlb);
+    return stats;
+}
+
+/**
+ * Función: nonblocking_table
+ * Descripción: Compara sobre una traza el tiempo medio efectivo (tiempo total
+ *              / accesos) de un TLB bloqueante y de TLB con acierto bajo
+ *              fallo y varios MSHR con el de la fórmula en serie. La columna
+ *              de traducción descuenta lo que tardaría la misma ventana con
+ *              un TLB que nunca falla.
+ */
+static void nonblocking_table(const Trace *trace, const char *title) {
+    struct {
+        const char *name;
+        int mshrs, window, blocking;
+    } configs[] = {
+        {"en serie (ventana 1)", 1, 1, 1},
+        {"bloqueante", 1, MLP_WINDOW, 1},
+        {"acierto bajo fallo, 1 MSHR", 1, MLP_WINDOW, 0},
+        {"2 MSHR", 2, MLP_WINDOW, 0},
+        {"4 MSHR", 4, MLP_WINDOW, 0},
+        {"8 MSHR", 8, MLP_WINDOW, 0},
+    };
+    const int num_configs = sizeof(configs) / sizeof(configs[0]);
+    PageTable *pt = page_table_build(trace, 0.5, 0xD1B54A32D192ED03ULL);
+    unsigned int *vpns = malloc(trace->length * sizeof(unsigned int));
+    double hit_latency = memory_timing.tlb_hit_time + memory_timing.memory_access_time;
+
+    for (long i = 0; i < trace->length; i++) vpns[i] = virtual_page_number(decompose_address(trace->addresses[i]));
+
+    // Fórmula en serie con la tasa de aciertos del TLB de 16x4
+    Tlb *tlb = tlb_create(16, 4, 0);
+    for (long i = 0; i < trace->length; i++) tlb_translate(tlb, pt, vpns[i]);
+    double serial = tlb_amat(tlb);
+    printf("%s: %ld accesos, TLB de 16x4, ventana de %d accesos, recorrido de %d x %.1f ns\n", title,
+           trace->length, MLP_WINDOW, PAGE_TABLE_LEVELS, page_walk_level_time());
+    printf(" Fórmula en serie con %.2f%% de aciertos: %.2f ns, de ellos %.2f ns por los fallos del TLB\n",
+           100.0 - 100.0 * tlb->misses / tlb->accesses, serial, serial - hit_latency);
+    tlb_destroy(tlb);
+
+    printf(" %-*s %9s %11s %13s %14s %11s\n", padded_width("Configuración", 27), "Configuración", "Fallos",
+           "Fusionados", "Esperas MSHR", "AMAT efectivo", "Traducción");
+    for (int c = 0; c < num_configs; c++) {
+        NonBlockingStats stats = simulate_nonblocking(vpns, trace->length, pt, configs[c].mshrs,
+                                                      configs[c].window, configs[c].blocking);
+        long rounds = (trace->length + configs[c].window - 1) / configs[c].window;
+        double amat = stats.elapsed / stats.accesses;
+        double perfect = rounds * hit_latency / stats.accesses;
+        printf(" %-*s %9ld %11ld %13ld %11.2f ns %8.2f ns\n", padded_width(configs[c].name, 27), configs[c].name,
+               stats.misses, stats.merged, stats.mshr_stalls, amat, amat - perfect);
+    }
+    page_table_destroy(pt);
+    free(vpns);
+}
+
+/**
+ * Función: run_nonblocking_comparison
+ * Descripción: Tabla del TLB no bloqueante para la traza dada, para un
+ *              bucle que recorre en secuencia tres vectores de 16MB (como
+ *              la tríada de STREAM: los tres piden página nueva en accesos
+ *              seguidos) y para lecturas independientes al azar en 64MB.
+ */
+void run_nonblocking_comparison(const Trace *trace) {
+    Trace stream = {malloc(trace->length * sizeof(unsigned int)), NULL, trace->length};
+    Trace gather = {malloc(trace->length * sizeof(unsigned int)), NULL, trace->length};
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+
+    for (long i = 0; i < trace->length; i++) {
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        // a[k] = b[k] + s * c[k]: tres vectores de 16MB que cambian de página a la vez
+        stream.addresses[i] = 0x10000000u + (unsigned int)(i % 3) * (16u << 20) +
+                              (unsigned int)(i / 3 * CACHE_LINE_SIZE % (16u << 20));
+        gather.addresses[i] = 0x10000000u + (unsigned int)(seed >> 40) % (64u << 20);
+    }
+    nonblocking_table(trace, "Traza");
+    printf("\n");
+    nonblocking_table(&stream, "Tríada sobre tres vectores");
+    printf("\n");
+    nonblocking_table(&gather, "Lecturas independientes al azar");
+    trace_free(&stream);
+    trace_free(&gather);
+}
+
+/* ------------------------------------------------------------------------
+ * Simulación por eventos discretos
+ * ------------------------------------------------------------------------
+ * En lugar de suponer el solapamiento y la contención, el simulador por
+ * eventos los reproduce: cada búsqueda en el TLB, cada nivel de un
+ * recorrido, cada respuesta de la DRAM y cada lectura del área de
+ * intercambio es un evento con su instante. Los eventos se guardan en una
+ * rueda de tiempos jerárquica: 8 niveles de 256 casillas, uno por cada byte
+ * del instante (en décimas de ns). Un evento va al nivel del byte más alto
+ * en que su instante difiere del actual y a la casilla de ese byte, así que
+ * programarlo y sacarlo cuesta O(1); cuando el nivel 0 se vacía, la primera
+ * casilla ocupada del nivel más bajo se reparte entre los niveles
+ * inferiores. Un mapa de bits por nivel evita recorrer casillas vacías.
+ * La DRAM tiene DRAM_CHANNELS canales, cada uno ocupado DRAM_BUSY_TIME por
+ * petición, y el dispositivo de intercambio atiende una página a la vez.
+ */
+
+#define WHEEL_LEVELS 8                // Niveles de la rueda: un byte del instante cada uno
+#define WHEEL_SLOTS 256               // Casillas por nivel
+#define EVENT_TICKS_PER_NS 10         // Resolución del reloj simulado: 0,1 ns
+#define EVENT_BLOCK 4096              // Eventos que se reservan de una vez
+#define DRAM_CHANNELS 2               // Canales de memoria
+#define DRAM_BUSY_TIME 5.0            // ns que un canal queda ocupado por una línea de 64 bytes
+#define SWAP_IO_TIME 50000.0          // ns desde que empieza la lectura de una página del intercambio hasta que llega
+#define SWAP_TRANSFER_TIME 4000.0     // ns que el dispositivo de intercambio queda ocupado por página
+
+typedef struct EventWheel EventWheel;
+typedef void (*EventHandler)(EventWheel *wheel, void *ctx, uint64_t arg);
+
+// Evento programado; los de una misma casilla forman una lista
+typedef struct Event {
+    uint64_t time;          // Instante en ticks
+    struct Event *next;
+    EventHandler handler;
+    void *ctx;
+    uint64_t arg;
+} Event;
+
+// Rueda de tiempos jerárquica
+struct EventWheel {
+    uint64_t now;                                      // Instante actual en ticks
+    Event *slots[WHEEL_LEVELS][WHEEL_SLOTS];
+    uint64_t occupied[WHEEL_LEVELS][WHEEL_SLOTS / 64]; // Casillas con eventos
+    Event *free_events;
+    Event **blocks;                                    // Bloques de eventos reservados
+    int num_blocks;
+    long processed;                                    // Eventos atendidos
+};
+
+/**
+ * Función: ns_to_ticks
+ * Descripción: Convierte un tiempo del modelo en ns a ticks de la rueda.
+ */
+uint64_t ns_to_ticks(double ns) {
+    return (uint64_t)(ns * EVENT_TICKS_PER_NS + 0.5);
+}
+
+EventWheel *wheel_create(void) {
+    return calloc(1, sizeof(EventWheel));
+}
+
+void wheel_destroy(EventWheel *wheel) {
+    for (int b = 0; b < wheel->num_blocks; b++) free(wheel->blocks[b]);
+    free(wheel->blocks);
+    free(wheel);
+}
+
+/**
+ * Función: wheel_insert
+ * Descripción: Coloca un evento en el nivel del byte más alto en que su
+ *              instante difiere del actual.
+ */
+static void wheel_insert(EventWheel *wheel, Event *event) {
+    uint64_t diff = event->time ^ wheel->now;
+    int level = diff ? (63 - __builtin_clzll(diff)) / 8 : 0;
+    int slot = event->time >> (8 * level) & (WHEEL_SLOTS - 1);
+
+    event->next = wheel->slots[level][slot];
+    wheel->slots[level][slot] = event;
+    wheel->occupied[level][slot / 64] |= 1ULL << (slot % 64);
+}
+
+/**
+ * Función: wheel_schedule
+ * Descripción: Programa una llamada a handler(wheel, ctx, arg) dentro de
+ *              'delay' ticks.
+ */
+void wheel_schedule(EventWheel *wheel, uint64_t delay, EventHandler handler, void *ctx, uint64_t arg) {
+    if (wheel->free_events == NULL) {
+        Event *block = malloc(EVENT_BLOCK * sizeof(Event));
+        for (int i = 0; i < EVENT_BLOCK - 1; i++) block[i].next = &block[i + 1];
+        block[EVENT_BLOCK - 1].next = NULL;
+        wheel->blocks = realloc(wheel->blocks, (wheel->num_blocks + 1) * sizeof(Event *));
+        wheel->blocks[wheel->num_blocks++] = block;
+        wheel->free_events = block;
+    }
+    Event *event = wheel->free_events;
+    wheel->free_events = event->next;
+    event->time = wheel->now + delay;
+    event->handler = handler;
+    event->ctx = ctx;
+    event->arg = arg;
+    wheel_insert(wheel, event);
+}
+
+/**
+ * Función: wheel_pop
+ * Descripción: Saca el evento más próximo y avanza el reloj hasta él.
+ * Retorno:
+ *   - El evento, o NULL si no queda ninguno.
+ */
+static Event *wheel_pop(EventWheel *wheel) {
+    for (;;) {
+        int level = 0, word = 0;
+        while (level < WHEEL_LEVELS) {
+            for (word = 0; word < WHEEL_SLOTS / 64 && !wheel->occupied[level][word]; word++);
+            if (word < WHEEL_SLOTS / 64) break;
+            level++;
+        }
+        if (level == WHEEL_LEVELS) return NULL;
+
+        int slot = word * 64 + __builtin_ctzll(wheel->occupied[level][word]);
+        Event *list = wheel->slots[level][slot];
+        if (level == 0) {
+            // Todos los eventos de una casilla del nivel 0 son del mismo instante
+            wheel->slots[0][slot] = list->next;
+            if (list->next == NULL) wheel->occupied[0][word] &= ~(1ULL << (slot % 64));
+            wheel->now = list->time;
+            return list;
+        }
+
+        // Los niveles inferiores están vacíos: el reloj salta al principio de la casilla y se reparte
+        wheel->slots[level][slot] = NULL;
+        wheel->occupied[level][word] &= ~(1ULL << (slot % 64));
+        int shift = 8 * level;
+        uint64_t upper = shift + 8 < 64 ? wheel->now >> (shift + 8) << (shift + 8) : 0;
+        wheel->now = upper | (uint64_t)slot << shift;
+        while (list) {
+            Event *next = list->next;
+            wheel_insert(wheel, list);
+            list = next;
+        }
+    }
+}
+
+/**
+ * Función: wheel_run
+ * Descripción: Atiende eventos en orden de tiempo hasta que no quede ninguno.
+ */
+void wheel_run(EventWheel *wheel) {
+    Event *event;
+    while ((event = wheel_pop(wheel)) != NULL) {
+        EventHandler handler = event->handler;
+        void *ctx = event->ctx;
+        uint64_t arg = event->arg;
+        event->next = wheel->free_events;
+        wheel->free_events = event;
+        wheel->processed++;
+        handler(wheel, ctx, arg);
+    }
+}
+
+// Canales de la DRAM compartidos por todos los núcleos
+typedef struct {
+    uint64_t channel_free[DRAM_CHANNELS]; // Instante en que cada canal queda libre
+    int channels;                         // Canales simulados; 0 = sin contención
+    long requests;
+    uint64_t queued;                      // Ticks esperando a un canal, sumados
+} DramModel;
+
+// Dispositivo de intercambio
+typedef struct {
+    uint64_t free;          // Instante en que queda libre
+    uint8_t *resident;      // resident[vpn]: 1 si la página está en memoria
+    long faults;
+    uint64_t queued;        // Ticks esperando al dispositivo, sumados
+} SwapDevice;
+
+// Acceso a memoria en vuelo
+typedef struct MemRequest {
+    unsigned int vpn;
+    uint64_t issued;             // Instante de emisión (ticks)
+    EventHandler done;           // Se llama con ctx y arg al llegar el dato
+    void *ctx;
+    uint64_t arg;
+    struct MemRequest *next;     // Siguiente en una lista de espera
+} MemRequest;
+
+// Recorrido de la tabla de páginas en curso (un MSHR)
+typedef struct {
+    unsigned int vpn;
+    int level;              // Niveles ya leídos
+    int busy;
+    MemRequest *waiters;    // Accesos que esperan esta traducción
+} PageWalk;
+
+// TLB de un núcleo con sus recorridos pendientes
+typedef struct {
+    EventWheel *wheel;
+    Tlb *tlb;
+    const PageTable *pt;
+    DramModel *dram;
+    SwapDevice *swap;
+    PageWalk walks[MAX_MSHRS];
+    int num_mshrs;
+    MemRequest *blocked;    // Fallos que esperan un MSHR libre
+    MemRequest **blocked_tail;
+    long lookups, hits, misses, merged, mshr_waits;
+} TimedMmu;
+
+static void mmu_lookup(EventWheel *wheel, void *ctx, uint64_t arg);
+static void mmu_walk_step(EventWheel *wheel, void *ctx, uint64_t arg);
+
+/**
+ * Función: dram_issue
+ * Descripción: Envía una petición a la DRAM: espera al primer canal libre,
+ *              lo ocupa DRAM_BUSY_TIME y su respuesta llega 'latency' ns
+ *              después de empezar.
+ */
+static void dram_issue(DramModel *dram, EventWheel *wheel, double latency, EventHandler handler, void *ctx,
+                       uint64_t arg) {
+    uint64_t start = wheel->now;
+    dram->requests++;
+    if (dram->channels > 0) {
+        int channel = 0;
+        for (int c = 1; c < dram->channels; c++) {
+            if (dram->channel_free[c] < dram->channel_free[channel]) channel = c;
+        }
+        if (dram->channel_free[channel] > start) start = dram->channel_free[channel];
+        dram->channel_free[channel] = start + ns_to_ticks(DRAM_BUSY_TIME);
+        dram->queued += start - wheel->now;
+    }
+    wheel_schedule(wheel, start - wheel->now + ns_to_ticks(latency), handler, ctx, arg);
+}
+
+/**
+ * Función: timed_access
+ * Descripción: Empieza un acceso a memoria: la búsqueda en el TLB termina
+ *              tlb_hit_time después y al llegar el dato se llama a req->done.
+ */
+void timed_access(TimedMmu *mmu, MemRequest *req) {
+    req->issued = mmu->wheel->now;
+    wheel_schedule(mmu->wheel, ns_to_ticks(memory_timing.tlb_hit_time), mmu_lookup, mmu, (uintptr_t)req);
+}
+
+/**
+ * Función: mmu_miss
+ * Descripción: Fallo del TLB: se une al recorrido de su página si lo hay,
+ *              empieza uno si hay un MSHR libre y si no espera a que se
+ *              libere.
+ * Retorno:
+ *   - 0 si el acceso tuvo que esperar un MSHR, 1 si no.
+ */
+static int mmu_miss(TimedMmu *mmu, MemRequest *req) {
+    int free_walk = -1;
+    for (int m = 0; m < mmu->num_mshrs; m++) {
+        PageWalk *walk = &mmu->walks[m];
+        if (walk->busy && walk->vpn == req->vpn) {
+            req->next = walk->waiters;
+            walk->waiters = req;
+            mmu->merged++;
+            return 1;
+        }
+        if (!walk->busy) free_walk = m;
+    }
+    if (free_walk < 0) {
+        req->next = NULL;
+        *mmu->blocked_tail = req;
+        mmu->blocked_tail = &req->next;
+        mmu->mshr_waits++;
+        return 0;
+    }
+    PageWalk *walk = &mmu->walks[free_walk];
+    req->next = NULL;
+    *walk = (PageWalk){req->vpn, 0, 1, req};
+    mmu->misses++;
+    dram_issue(mmu->dram, mmu->wheel, page_walk_level_time(), mmu_walk_step, mmu, free_walk);
+    return 1;
+}
+
+/**
+ * Función: mmu_lookup
+ * Descripción: Evento de fin de la búsqueda en el TLB.
+ */
+static void mmu_lookup(EventWheel *wheel, void *ctx, uint64_t arg) {
+    TimedMmu *mmu = ctx;
+    MemRequest *req = (MemRequest *)(uintptr_t)arg;
+
+    mmu->lookups++;
+    if (tlb_probe(mmu->tlb, req->vpn) >= 0) {
+        mmu->hits++;
+        dram_issue(mmu->dram, wheel, memory_timing.memory_access_time, req->done, req->ctx, req->arg);
+    } else {
+        mmu_miss(mmu, req);
+    }
+}
+
+/**
+ * Función: mmu_walk_complete
+ * Descripción: La traducción entra en el TLB, los accesos que la esperaban
+ *              piden su dato y el MSHR pasa a los fallos bloqueados.
+ */
+static void mmu_walk_complete(TimedMmu *mmu, int index) {
+    PageWalk *walk = &mmu->walks[index];
+    int frame = page_table_walk(mmu->pt, walk->vpn);
+
+    if (frame >= 0) tlb_fill(mmu->tlb, mmu->pt, walk->vpn, frame, NULL);
+    for (MemRequest *req = walk->waiters, *next; req; req = next) {
+        next = req->next;
+        dram_issue(mmu->dram, mmu->wheel, memory_timing.memory_access_time, req->done, req->ctx, req->arg);
+    }
+    walk->busy = 0;
+    walk->waiters = NULL;
+
+    // Los fallos bloqueados se atienden en orden hasta que uno vuelve a quedarse sin MSHR
+    while (mmu->blocked) {
+        MemRequest *req = mmu->blocked;
+        mmu->blocked = req->next;
+        if (mmu->blocked == NULL) mmu->blocked_tail = &mmu->blocked;
+        if (tlb_contains(mmu->tlb, req->vpn)) {
+            dram_issue(mmu->dram, mmu->wheel, memory_timing.memory_access_time, req->done, req->ctx, req->arg);
+        } else if (!mmu_miss(mmu, req)) {
+            break;
+        }
+    }
+}
+
+/**
+ * Función: mmu_swap_done
+ * Descripción: Evento de fin de la lectura de una página del intercambio.
+ */
+static void mmu_swap_done(EventWheel *wheel, void *ctx, uint64_t arg) {
+    TimedMmu *mmu = ctx;
+    (void)wheel;
+    mmu->swap->resident[mmu->walks[arg].vpn] = 1;
+    mmu_walk_complete(mmu, (int)arg);
+}
+
+/**
+ * Función: mmu_walk_step
+ * Descripción: Evento de llegada de un nivel de la tabla de páginas. Tras el
+ *              último, una página que no está en memoria se lee del
+ *              intercambio antes de completar la traducción.
+ */
+static void mmu_walk_step(EventWheel *wheel, void *ctx, uint64_t arg) {
+    TimedMmu *mmu = ctx;
+    PageWalk *walk = &mmu->walks[arg];
+
+    if (++walk->level < PAGE_TABLE_LEVELS) {
+        dram_issue(mmu->dram, wheel, page_walk_level_time(), mmu_walk_step, mmu, arg);
+    } else if (mmu->swap && !mmu->swap->resident[walk->vpn]) {
+        SwapDevice *swap = mmu->swap;
+        uint64_t start = swap->free > wheel->now ? swap->free : wheel->now;
+        swap->faults++;
+        swap->queued += start - wheel->now;
+        swap->free = start + ns_to_ticks(SWAP_TRANSFER_TIME);
+        wheel_schedule(wheel, start - wheel->now + ns_to_ticks(SWAP_IO_TIME), mmu_swap_done, mmu, arg);
+    } else {
+        mmu_walk_complete(mmu, (int)arg);
+    }
+}
+
+/**
+ * Función: mmu_init
+ * Descripción: Prepara el TLB de 16x4 de un núcleo con 'num_mshrs' recorridos simultáneos.
+ */
+void mmu_init(TimedMmu *mmu, EventWheel *wheel, const PageTable *pt, DramModel *dram, SwapDevice *swap,
+              int num_mshrs) {
+    memset(mmu, 0, sizeof(*mmu));
+    mmu->wheel = wheel;
+    mmu->tlb = tlb_create(16, 4, 0);
+    mmu->pt = pt;
+    mmu->dram = dram;
+    mmu->swap = swap;
+    mmu->num_mshrs = num_mshrs;
+    mmu->blocked_tail = &mmu->blocked;
+}
+
+/**
+ * Función: swap_init
+ * Descripción: Marca como fuera de memoria una fracción 'fraction' de las
+ *              páginas, elegidas con un hash del número de página.
+ */
+void swap_init(SwapDevice *swap, double fraction) {
+    memset(swap, 0, sizeof(*swap));
+    swap->resident = malloc(1 << 20);
+    for (uint32_t vpn = 0; vpn < (1u << 20); vpn++) {
+        uint32_t h = vpn * 0x9E3779B1u;
+        swap->resident[vpn] = (h ^ h >> 16) % 1000000 >= fraction * 1000000;
+    }
+}
+
+// Núcleo que emite los accesos de su parte de la traza con una ventana de accesos en vuelo
+typedef struct {
+    TimedMmu mmu;
+    const unsigned int *vpns;
+    long next, end;
+    MemRequest *requests;   // Un MemRequest por hueco de la ventana
+    long completed;
+    uint64_t latency;       // Ticks desde la emisión hasta el dato, sumados
+    uint64_t finished;      // Instante en que llegó el último dato
+} SimCore;
+
+/**
+ * Función: core_data
+ * Descripción: Evento de llegada del dato de un acceso: el hueco de la
+ *              ventana se usa para el siguiente acceso de la traza.
+ */
+static void core_data(EventWheel *wheel, void *ctx, uint64_t arg) {
+    SimCore *core = ctx;
+    MemRequest *req = (MemRequest *)(uintptr_t)arg;
+
+    core->completed++;
+    core->latency += wheel->now - req->issued;
+    core->finished = wheel->now;
+    if (core->next < core->end) {
+        req->vpn = core->vpns[core->next++];
+        timed_access(&core->mmu, req);
+    }
+}
+
+/**
+ * Función: wheel_benchmark
+ * Descripción: Mide el motor solo: 'timers' temporizadores que se
+ *              reprograman con retardos aleatorios de hasta 6,5 µs hasta
+ *              atender 'events' eventos.
+ * Retorno:
+ *   - Millones de eventos por segundo.
+ */
+static long wheel_benchmark_left;
+
+static void wheel_benchmark_timer(EventWheel *wheel, void *ctx, uint64_t arg) {
+    uint64_t *rng = ctx;
+    *rng ^= *rng << 13; *rng ^= *rng >> 7; *rng ^= *rng << 17;
+    if (--wheel_benchmark_left > 0) wheel_schedule(wheel, 1 + *rng % 65536, wheel_benchmark_timer, ctx, arg);
+}
+
+double wheel_benchmark(int timers, long events) {
+    EventWheel *wheel = wheel_create();
+    uint64_t rng = 0x9E3779B97F4A7C15ULL;
+
+    wheel_benchmark_left = events;
+    for (int t = 0; t < timers; t++) wheel_schedule(wheel, t, wheel_benchmark_timer, &rng, t);
+    double start = now_ns();
+    wheel_run(wheel);
+    double elapsed = now_ns() - start;
+    double rate = wheel->processed / elapsed * 1000.0;
+    wheel_destroy(wheel);
+    return rate;
+}
+
+/**
+ * Función: run_event_simulation
+ * Descripción: Reparte la traza entre núcleos y la simula por eventos en
+ *              varios escenarios: en serie (debe coincidir con la forma
+ *              cerrada), con ventana y MSHR, con varios núcleos compitiendo
+ *              por los canales de la DRAM y con parte de las páginas en el
+ *              intercambio. La forma cerrada es calculate_memory_access_time
+ *              con la tasa de aciertos medida, más la búsqueda en el TLB que
+ *              también hace un fallo antes de recorrer la tabla; no incluye
+ *              el intercambio.
+ */
+void run_event_simulation(const Trace *trace) {
+    struct {
+        const char *name;
+        int cores, window, mshrs, channels;
+        double swap_fraction;
+    } scenarios[] = {
+        {"1 núcleo en serie", 1, 1, 1, 0, 0.0},
+        {"1 núcleo, ventana 16, 4 MSHR", 1, MLP_WINDOW, 4, 0, 0.0},
+        {"4 núcleos, sin contención", 4, MLP_WINDOW, 4, 0, 0.0},
+        {"4 núcleos, 2 canales DRAM", 4, MLP_WINDOW, 4, DRAM_CHANNELS, 0.0},
+        {"4 núcleos, 2 canales, 1% swap", 4, MLP_WINDOW, 4, DRAM_CHANNELS, 0.01},
+    };
+    const int num_scenarios = sizeof(scenarios) / sizeof(scenarios[0]);
+    PageTable *pt = page_table_build(trace, 0.5, 0xD1B54A32D192ED03ULL);
+    unsigned int *vpns = malloc(trace->length * sizeof(unsigned int));
+
+    for (long i = 0; i < trace->length; i++) vpns[i] = virtual_page_number(decompose_address(trace->addresses[i]));
+
+    printf("Motor de eventos solo: %.1f millones de eventos/s (4096 temporizadores)\n\n",
+           wheel_benchmark(4096, 20000000));
+    printf("Simulación por eventos: %ld accesos, TLB de 16x4 por núcleo, canal DRAM ocupado %.1f ns por línea\n",
+           trace->length, DRAM_BUSY_TIME);
+    printf(" %-*s %10s %7s %10s %10s %10s %10s %8s\n", padded_width("Escenario", 30), "Escenario", "Eventos",
+           "Mev/s", "Latencia", "Cerrada", "Efectivo", "Cola DRAM", "Swap");
+    for (int s = 0; s < num_scenarios; s++) {
+        int cores = scenarios[s].cores, window = scenarios[s].window;
+        EventWheel *wheel = wheel_create();
+        DramModel dram = {{0}, scenarios[s].channels, 0, 0};
+        SwapDevice swap;
+        SimCore *core = calloc(cores, sizeof(SimCore));
+
+        swap_init(&swap, scenarios[s].swap_fraction);
+        for (int c = 0; c < cores; c++) {
+            mmu_init(&core[c].mmu, wheel, pt, &dram, &swap, scenarios[s].mshrs);
+            core[c].vpns = vpns;
+            core[c].next = trace->length * c / cores;
+            core[c].end = trace->length * (c + 1) / cores;
+            core[c].requests = calloc(window, sizeof(MemRequest));
+            for (int w = 0; w < window && core[c].next < core[c].end; w++) {
+                MemRequest *req = &core[c].requests[w];
+                *req = (MemRequest){vpns[core[c].next++], 0, core_data, &core[c], (uintptr_t)req, NULL};
+                timed_access(&core[c].mmu, req);
+            }
+        }
+
+        double start = now_ns();
+        wheel_run(wheel);
+        double host_ns = now_ns() - start;
+
+        long completed = 0, lookups = 0, hits = 0;
+        uint64_t latency = 0, finished = 0;
+        for (int c = 0; c < cores; c++) {
+            completed += core[c].completed;
+            latency += core[c].latency;
+            lookups += core[c].mmu.lookups;
+            hits += core[c].mmu.hits;
+            if (core[c].finished > finished) finished = core[c].finished;
+            tlb_destroy(core[c].mmu.tlb);
+            free(core[c].requests);
+        }
+        double configured_rate = memory_timing.tlb_hit_rate;
+        memory_timing.tlb_hit_rate = (double)hits / lookups;
+        double closed = calculate_memory_access_time() + (1 - memory_timing.tlb_hit_rate) * memory_timing.tlb_hit_time;
+        memory_timing.tlb_hit_rate = configured_rate;
+
+        printf(" %-*s %10ld %7.1f %7.2f ns %7.2f ns %7.2f ns %7.2f ns %8ld\n",
+               padded_width(scenarios[s].name, 30), scenarios[s].name, wheel->processed,
+               wheel->processed / host_ns * 1000.0, (double)latency / completed / EVENT_TICKS_PER_NS, closed,
+               (double)finished * cores / completed / EVENT_TICKS_PER_NS,
+               dram.requests ? (double)dram.queued / dram.requests / EVENT_TICKS_PER_NS : 0.0, swap.faults);
+        free(swap.resident);
+        free(core);
+        wheel_destroy(wheel);
+    }
+    printf(" (Latencia: media desde la emisión hasta el dato. Efectivo: tiempo simulado x núcleos / accesos.)\n");
+    page_table_destroy(pt);
+    free(vpns);
+}
+
+/* ------------------------------------------------------------------------
+ * Hilos simulados como corrutinas
+ * ------------------------------------------------------------------------
+ * Cada hilo de la aplicación simulada es una corrutina sin pila: una
+ * función que guarda sus variables en su estructura y, al suspenderse,
+ * apunta en 'state' la línea por la que debe seguir (un switch salta allí
+ * al reanudarla). Los aciertos del TLB se resuelven dentro del hilo, que
+ * acumula su tiempo por delante del reloj de la rueda hasta un quantum
+ * (desacoplamiento temporal); en un fallo del TLB el hilo se suspende y el
+ * motor de eventos lo reanuda cuando termina el recorrido de la tabla y,
+ * si la página está en el intercambio, su lectura. Así miles de hilos
+ * tienen fallos en vuelo a la vez y cuestan unos cientos de bytes cada uno.
+ * Cada hilo anfitrión simula un nodo independiente (su rueda, sus núcleos,
+ * su DRAM y su dispositivo de intercambio), de modo que no hace falta
+ * sincronizarlos; sólo comparten la tabla de páginas, que no se modifica.
+ */
+
+#define COROUTINE_DEFAULT_THREADS 4096  // Hilos simulados por defecto
+#define COROUTINE_MAX_THREADS 8192      // Caben sus regiones privadas en el espacio de 32 bits
+#define COROUTINE_HOSTS_PER_CPU 2       // Hilos anfitriones máximos por procesador en línea
+#define COROUTINE_STEPS 1000            // Accesos de cada hilo simulado
+#define COROUTINE_QUANTUM 1000.0        // ns que un hilo puede adelantarse al reloj sin suspenderse
+#define NODE_CORES 2                    // Núcleos (TLB) de cada nodo
+#define THREAD_PRIVATE_PAGES 68         // Pila (4 páginas) y vector privado (64 páginas) de cada hilo
+#define SHARED_HEAP_PAGES 16384         // Montículo compartido de 64MB
+#define SHARED_HEAP_BASE 0x10000000u
+#define PRIVATE_BASE 0x20000000u
+
+// Una corrutina sin pila: el switch de CO_BEGIN salta a la línea guardada en 'state'
+#define CO_BEGIN(co) switch ((co)->state) { case 0:
+#define CO_AWAIT(co, start) do { (co)->state = __LINE__; start; return; case __LINE__:; } while (0)
+#define CO_END(co) } (co)->state = -1
+
+typedef struct SimNode SimNode;
+
+// Hilo de la aplicación simulada
+typedef struct {
+    int state;              // Punto de reanudación de la corrutina (0 = inicio, -1 = terminado)
+    int id;
+    long step;              // Variables que sobreviven a una suspensión
+    uint64_t rng;
+    unsigned int stream;
+    uint64_t ahead;         // Ticks que el hilo va por delante del reloj de la rueda
+    TimedMmu *mmu;
+    SimNode *node;
+    MemRequest req;
+} SimThread;
+
+// Máquina simulada por un hilo anfitrión
+struct SimNode {
+    EventWheel *wheel;
+    DramModel dram;
+    SwapDevice swap;
+    TimedMmu mmu[NODE_CORES];
+    SimThread *threads;
+    int num_threads;
+    long accesses, hits, suspensions;
+    uint64_t waiting;       // Ticks que los hilos pasaron suspendidos en fallos, sumados
+    uint64_t finished;      // Instante en que terminó el último hilo
+    int running;            // Hilos que no han terminado
+    double host_ns;
+};
+
+static void thread_run(SimThread *thread);
+
+/**
+ * Función: thread_resume
+ * Descripción: Evento que reanuda un hilo simulado: fin de un quantum o llegada del dato de un fallo.
+ */
+static void thread_resume(EventWheel *wheel, void *ctx, uint64_t arg) {
+    SimThread *thread = ctx;
+    if (arg) thread->node->waiting += wheel->now - thread->req.issued;
+    thread_run(thread);
+}
+
+/**
+ * Función: thread_fault
+ * Descripción: Evento que lleva el fallo de un hilo al MMU de su núcleo en
+ *              el instante al que había llegado el hilo.
+ */
+static void thread_fault(EventWheel *wheel, void *ctx, uint64_t arg) {
+    SimThread *thread = ctx;
+    (void)wheel;
+    (void)arg;
+    timed_access(thread->mmu, &thread->req);
+}
+
+/**
+ * Función: thread_next_address
+ * Descripción: Siguiente dirección del programa de un hilo: la mitad de los
+ *              accesos a su pila, un 30% recorriendo su vector privado y el
+ *              resto al azar en el montículo compartido.
+ */
+static unsigned int thread_next_address(SimThread *thread) {
+    uint64_t *rng = &thread->rng;
+    *rng ^= *rng << 13; *rng ^= *rng >> 7; *rng ^= *rng << 17;
+    unsigned int r = (unsigned int)(*rng >> 32);
+    unsigned int private = PRIVATE_BASE + (unsigned int)thread->id * THREAD_PRIVATE_PAGES * PAGE_SIZE;
+
+    if (r % 10 < 5) return private + r % (4 * PAGE_SIZE);
+    if (r % 10 < 8) {
+        thread->stream = (thread->stream + CACHE_LINE_SIZE) % (64 * PAGE_SIZE);
+        return private + 4 * PAGE_SIZE + thread->stream;
+    }
+    return SHARED_HEAP_BASE + (r >> 4) % (SHARED_HEAP_PAGES * PAGE_SIZE);
+}
+
+/**
+ * Función: thread_run
+ * Descripción: Cuerpo del hilo simulado. Cada llamada sigue desde el punto
+ *              en que se suspendió hasta la siguiente suspensión.
+ */
+static void thread_run(SimThread *thread) {
+    SimNode *node = thread->node;
+
+    CO_BEGIN(thread);
+    for (thread->step = 0; thread->step < COROUTINE_STEPS; thread->step++) {
+        thread->req.vpn = virtual_page_number(decompose_address(thread_next_address(thread)));
+        node->accesses++;
+        if (tlb_probe(thread->mmu->tlb, thread->req.vpn) >= 0) {
+            // Acierto: el hilo sigue sin suspenderse salvo que se adelante demasiado al reloj
+            node->hits++;
+            thread->ahead += ns_to_ticks(memory_timing.tlb_hit_time + memory_timing.memory_access_time);
+            if (thread->ahead >= ns_to_ticks(COROUTINE_QUANTUM)) {
+                CO_AWAIT(thread, (wheel_schedule(node->wheel, thread->ahead, thread_resume, thread, 0),
+                                  thread->ahead = 0));
+            }
+            continue;
+        }
+        // Fallo: el hilo se suspende hasta que el motor entrega el dato (recorrido e intercambio incluidos)
+        node->suspensions++;
+        CO_AWAIT(thread, (wheel_schedule(node->wheel, thread->ahead, thread_fault, thread, 0), thread->ahead = 0));
+    }
+    CO_END(thread);
+    node->finished = node->wheel->now + thread->ahead;
+    node->running--;
+}
+
+/**
+ * Función: node_thread
+ * Descripción: Hilo anfitrión: simula un nodo con sus hilos hasta que todos terminan.
+ */
+static void *node_thread(void *arg) {
+    SimNode *node = arg;
+    double start = now_ns();
+    for (int t = 0; t < node->num_threads; t++) thread_run(&node->threads[t]);
+    wheel_run(node->wheel);
+    node->host_ns = now_ns() - start;
+    return NULL;
+}
+
+/**
+ * Función: run_coroutine_threads
+ * Descripción: Simula 'num_threads' hilos de aplicación repartidos entre
+ *              'host_threads' nodos, cada uno en un hilo anfitrión con
+ *              NODE_CORES núcleos y el 1% de las páginas en el intercambio,
+ *              e informa de la memoria por hilo simulado y de cuánto se
+ *              solapan sus fallos (hilos suspendidos de media).
+ */
+void run_coroutine_threads(int num_threads, int host_threads) {
+    if (host_threads > num_threads) host_threads = num_threads; // Cada nodo necesita al menos un hilo simulado
+
+    PageTable *pt = page_table_create();
+    SimNode *nodes = calloc(host_threads, sizeof(SimNode));
+    pthread_t *handles = malloc(host_threads * sizeof(pthread_t));
+    int frame = 0;
+
+    for (unsigned int p = 0; p < SHARED_HEAP_PAGES; p++) {
+        page_table_map(pt, virtual_page_number(decompose_address(SHARED_HEAP_BASE + p * PAGE_SIZE)), frame++);
+    }
+    for (unsigned int p = 0; p < (unsigned int)num_threads * THREAD_PRIVATE_PAGES; p++) {
+        page_table_map(pt, virtual_page_number(decompose_address(PRIVATE_BASE + p * PAGE_SIZE)), frame++);
+    }
+
+    for (int n = 0; n < host_threads; n++) {
+        SimNode *node = &nodes[n];
+        int first = num_threads * n / host_threads, last = num_threads * (n + 1) / host_threads;
+        node->wheel = wheel_create();
+        node->dram.channels = DRAM_CHANNELS;
+        swap_init(&node->swap, 0.01);
+        for (int c = 0; c < NODE_CORES; c++) mmu_init(&node->mmu[c], node->wheel, pt, &node->dram, &node->swap, 4);
+        node->num_threads = node->running = last - first;
+        node->threads = calloc(node->num_threads, sizeof(SimThread));
+        for (int t = 0; t < node->num_threads; t++) {
+            SimThread *thread = &node->threads[t];
+            thread->id = first + t;
+            thread->rng = 0x9E3779B97F4A7C15ULL ^ (uint64_t)(first + t + 1) * 0xD1B54A32D192ED03ULL;
+            thread->mmu = &node->mmu[t % NODE_CORES];
+            thread->node = node;
+            thread->req = (MemRequest){0, 0, thread_resume, thread, 1, NULL};
+        }
+    }
+
+    double start = now_ns();
+    for (int n = 0; n < host_threads; n++) pthread_create(&handles[n], NULL, node_thread, &nodes[n]);
+    for (int n = 0; n < host_threads; n++) pthread_join(handles[n], NULL);
+    double host_ns = now_ns() - start;
+
+    printf("Hilos simulados como corrutinas: %d hilos en %d hilos anfitriones, %d núcleos de 16x4 con 4 MSHR por nodo\n",
+           num_threads, host_threads, NODE_CORES);
+    printf(" Memoria por hilo simulado: %zu bytes (una pila de pthread ocupa 8MB por defecto)\n", sizeof(SimThread));
+    printf(" %4s %7s %10s %9s %12s %8s %11s %15s %12s\n", "Nodo", "Hilos", "Accesos", "Aciertos", "Suspensiones",
+           "Swap", "Eventos", "Tiempo simulado", "Suspendidos");
+    long accesses = 0, events = 0;
+    for (int n = 0; n < host_threads; n++) {
+        SimNode *node = &nodes[n];
+        accesses += node->accesses;
+        events += node->wheel->processed;
+        printf(" %4d %7d %10ld %8.2f%% %12ld %8ld %11ld %12.1f µs %12.1f\n", n, node->num_threads,
+               node->accesses, 100.0 * node->hits / node->accesses, node->suspensions, node->swap.faults,
+               node->wheel->processed, node->finished / 1000.0 / EVENT_TICKS_PER_NS,
+               node->finished ? (double)node->waiting / node->finished : 0.0);
+        if (node->running) printf("      %d hilos no terminaron\n", node->running);
+        for (int c = 0; c < NODE_CORES; c++) tlb_destroy(node->mmu[c].tlb);
+        free(node->threads);
+        free(node->swap.resident);
+        wheel_destroy(node->wheel);
+    }
+    printf(" (Suspendidos: hilos esperando un fallo de media, tiempo de espera sumado / tiempo simulado.)\n");
+    printf(" %ld accesos y %ld eventos en %.2f s del anfitrión: %.1f millones de accesos/s\n", accesses, events,
+           host_ns / 1e9, accesses / host_ns * 1000.0);
+    free(handles);
+    free(nodes);
+    page_table_destroy(pt);
+}
+
+/* ------------------------------------------------------------------------
+ * Planificador con robo de trabajo
+ * ------------------------------------------------------------------------
+ * Los barridos de parámetros y las réplicas de trazas son trabajos de
+ * tamaños muy distintos. Cada trabajador tiene una cola doble de Chase-Lev:
+ * mete y saca tareas por abajo sin bloqueos y, cuando se queda sin trabajo,
+ * roba por arriba de la cola de otro trabajador elegido al azar (sólo los
+ * robos compiten, con un CAS sobre 'top'). Las tareas sobre un rango de
+ * índices se parten por la mitad y dejan la otra mitad en la cola, así que
+ * los ladrones se llevan trozos grandes y el reparto no depende de un único
+ * productor. El contador de tareas pendientes es el único dato global.
+ */
+
+#define DEQUE_INITIAL_SIZE 256      // Tareas que caben en una cola antes de crecer
+#define POOL_MIN_WORKERS 4          // Trabajadores mínimos por defecto (aunque haya menos procesadores)
+#define POOL_MAX_WORKERS 256        // Trabajadores máximos que se pueden pedir
+#define GRID_HIT_RATES 2000         // Puntos de la rejilla de calculate_memory_access_time
+#define GRID_WALK_TIMES 1000
+#define GRID_TLB_TIMES 16
+#define GRID_TARGET_AMAT 100.0      // ns: tiempo objetivo para la tasa de aciertos mínima
+#define TRACE_SHARDS 48             // Trozos de la traza por geometría
+
+typedef struct Worker Worker;
+
+// Cabecera de toda tarea: la función que la ejecuta
+typedef struct Task {
+    void (*run)(struct Task *task, Worker *worker);
+} Task;
+
+// Vector circular de una cola; al crecer, el anterior se guarda hasta destruir la cola
+typedef struct DequeArray {
+    long size;
+    struct DequeArray *previous;
+    _Atomic(Task *) slots[];
+} DequeArray;
+
+// Cola doble de Chase-Lev
+typedef struct {
+    _Alignas(64) atomic_long top;       // Por aquí roban los demás
+    _Alignas(64) atomic_long bottom;    // Por aquí mete y saca el dueño
+    _Atomic(DequeArray *) array;
+} WsDeque;
+
+typedef struct WorkPool WorkPool;
+
+// Trabajador: un hilo con su cola y sus contadores, en líneas de caché propias
+struct Worker {
+    WsDeque deque;
+    WorkPool *pool;
+    int id;
+    uint64_t rng;
+    long executed;          // Tareas ejecutadas
+    long steals;            // Tareas robadas
+    long failed_steals;     // Robos que encontraron la cola vacía o perdieron la carrera
+    double busy_ns;         // Tiempo de CPU ejecutando tareas
+    pthread_t thread;
+} __attribute__((aligned(64)));
+
+struct WorkPool {
+    Worker *workers;
+    int num_workers;
+    _Alignas(64) atomic_long pending;   // Tareas creadas que no han terminado
+};
+
+static DequeArray *deque_array_create(long size, DequeArray *previous) {
+    DequeArray *array = malloc(sizeof(DequeArray) + size * sizeof(_Atomic(Task *)));
+    array->size = size;
+    array->previous = previous;
+    return array;
+}
+
+void deque_init(WsDeque *deque) {
+    atomic_init(&deque->top, 0);
+    atomic_init(&deque->bottom, 0);
+    atomic_init(&deque->array, deque_array_create(DEQUE_INITIAL_SIZE, NULL));
+}
+
+void deque_destroy(WsDeque *deque) {
+    DequeArray *array = atomic_load(&deque->array);
+    while (array) {
+        DequeArray *previous = array->previous;
+        free(array);
+        array = previous;
+    }
+}
+
+/**
+ * Función: deque_push
+ * Descripción: El dueño mete una tarea por abajo; si el vector está lleno
+ *              lo dobla copiando las tareas vivas.
+ */
+void deque_push(WsDeque *deque, Task *task) {
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    DequeArray *array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+
+    if (bottom - top > array->size - 1) {
+        DequeArray *bigger = deque_array_create(array->size * 2, array);
+        for (long i = top; i < bottom; i++) {
+            atomic_store_explicit(&bigger->slots[i % bigger->size],
+                                  atomic_load_explicit(&array->slots[i % array->size], memory_order_relaxed),
+                                  memory_order_relaxed);
+        }
+        atomic_store_explicit(&deque->array, bigger, memory_order_release);
+        array = bigger;
+    }
+    atomic_store_explicit(&array->slots[bottom % array->size], task, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+}
+
+/**
+ * Función: deque_take
+ * Descripción: El dueño saca la última tarea que metió. Sólo compite con
+ *              los ladrones cuando queda una tarea.
+ * Retorno:
+ *   - La tarea, o NULL si la cola está vacía.
+ */
+Task *deque_take(WsDeque *deque) {
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    DequeArray *array = atomic_load_explicit(&deque->array, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+    Task *task = NULL;
+
+    if (top <= bottom) {
+        task = atomic_load_explicit(&array->slots[bottom % array->size], memory_order_relaxed);
+        if (top == bottom) {
+            // Última tarea: se la disputa con los ladrones
+            if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst,
+                                                         memory_order_relaxed)) {
+                task = NULL;
+            }
+            atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        }
+    } else {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+/**
+ * Función: deque_steal
+ * Descripción: Otro trabajador se lleva la tarea más antigua de la cola.
+ * Retorno:
+ *   - La tarea, o NULL si la cola está vacía o se la llevó otro.
+ */
+Task *deque_steal(WsDeque *deque) {
+    long top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+
+    if (top >= bottom) return NULL;
+    DequeArray *array = atomic_load_explicit(&deque->array, memory_order_acquire);
+    Task *task = atomic_load_explicit(&array->slots[top % array->size], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1, memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+        return NULL;
+    }
+    return task;
+}
+
+/**
+ * Función: pool_spawn
+ * Descripción: Crea una tarea en la cola del trabajador que la lanza.
+ */
+void pool_spawn(Worker *worker, Task *task) {
+    atomic_fetch_add_explicit(&worker->pool->pending, 1, memory_order_relaxed);
+    deque_push(&worker->deque, task);
+}
+
+static double thread_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/**
+ * Función: worker_loop
+ * Descripción: Ejecuta tareas de la propia cola y, cuando se vacía, roba a
+ *              trabajadores al azar hasta que no queda ninguna pendiente.
+ */
+static void *worker_loop(void *arg) {
+    Worker *worker = arg;
+    WorkPool *pool = worker->pool;
+    long idle = 0;
+
+    while (atomic_load_explicit(&pool->pending, memory_order_acquire) > 0) {
+        Task *task = deque_take(&worker->deque);
+        if (task == NULL && pool->num_workers > 1) {
+            worker->rng ^= worker->rng << 13; worker->rng ^= worker->rng >> 7; worker->rng ^= worker->rng << 17;
+            int victim = worker->rng % (pool->num_workers - 1);
+            victim += victim >= worker->id; // Cualquiera menos él mismo
+            task = deque_steal(&pool->workers[victim].deque);
+            if (task) worker->steals++;
+            else worker->failed_steals++;
+        }
+        if (task == NULL) {
+            if (++idle % 64 == 0) sched_yield();
+            continue;
+        }
+        idle = 0;
+        double start = thread_cpu_ns();
+        task->run(task, worker);
+        worker->busy_ns += thread_cpu_ns() - start;
+        worker->executed++;
+        atomic_fetch_sub_explicit(&pool->pending, 1, memory_order_release);
+    }
+    return NULL;
+}
+
+WorkPool *pool_create(int num_workers) {
+    WorkPool *pool = calloc(1, sizeof(WorkPool));
+    pool->num_workers = num_workers;
+    pool->workers = aligned_alloc(64, num_workers * sizeof(Worker));
+    memset(pool->workers, 0, num_workers * sizeof(Worker));
+    for (int w = 0; w < num_workers; w++) {
+        pool->workers[w].pool = pool;
+        pool->workers[w].id = w;
+        pool->workers[w].rng = 0x9E3779B97F4A7C15ULL * (w + 1);
+        deque_init(&pool->workers[w].deque);
+    }
+    return pool;
+}
+
+void pool_destroy(WorkPool *pool) {
+    for (int w = 0; w < pool->num_workers; w++) deque_destroy(&pool->workers[w].deque);
+    free(pool->workers);
+    free(pool);
+}
+
+/**
+ * Función: pool_run
+ * Descripción: Ejecuta una tarea raíz y todas las que lance. El hilo que
+ *              llama hace de trabajador 0.
+ * Retorno:
+ *   - Tiempo transcurrido en ns.
+ */
+double pool_run(WorkPool *pool, Task *root) {
+    double start = now_ns();
+    pool_spawn(&pool->workers[0], root);
+    for (int w = 1; w < pool->num_workers; w++) {
+        pthread_create(&pool->workers[w].thread, NULL, worker_loop, &pool->workers[w]);
+    }
+    worker_loop(&pool->workers[0]);
+    for (int w = 1; w < pool->num_workers; w++) pthread_join(pool->workers[w].thread, NULL);
+    return now_ns() - start;
+}
+
+// Tarea sobre los índices [first, last): se parte por la mitad hasta quedarse con uno
+typedef struct {
+    Task task;
+    void (*leaf)(long index, void *ctx);
+    void *ctx;
+    long first, last;
+} RangeTask;
+
+static void range_task_run(Task *task, Worker *worker) {
+    RangeTask *range = (RangeTask *)task;
+    while (range->last - range->first > 1) {
+        RangeTask *half = malloc(sizeof(RangeTask));
+        long middle = range->first + (range->last - range->first) / 2;
+        *half = (RangeTask){{range_task_run}, range->leaf, range->ctx, middle, range->last};
+        range->last = middle;
+        pool_spawn(worker, &half->task);
+    }
+    range->leaf(range->first, range->ctx);
+    free(range);
+}
+
+/**
+ * Función: range_task_create
+ * Descripción: Tarea que llama a leaf(i, ctx) para cada i de [first, last).
+ */
+Task *range_task_create(long first, long last, void (*leaf)(long index, void *ctx), void *ctx) {
+    RangeTask *range = malloc(sizeof(RangeTask));
+    *range = (RangeTask){{range_task_run}, leaf, ctx, first, last};
+    return &range->task;
+}
+
+// Trabajos del barrido: una rejilla de tiempos y las réplicas de trozos de traza
+typedef struct {
+    float *min_hit_rate;        // [tiempo de recorrido][tiempo de TLB]: tasa de aciertos mínima para GRID_TARGET_AMAT
+    const unsigned int *vpns;
+    const PageTable *pt;
+    const long *shard_first;    // TRACE_SHARDS + 1 límites de los trozos
+    const int (*geometries)[2]; // {conjuntos, vías}
+    int num_geometries;
+    long *shard_misses;         // [geometría][trozo]
+} SweepJobs;
+
+/**
+ * Función: grid_row
+ * Descripción: Fila de la rejilla para un tiempo de recorrido: para cada
+ *              tiempo de TLB, la menor tasa de aciertos con la que
+ *              calculate_memory_access_time no pasa de GRID_TARGET_AMAT.
+ */
+static void grid_row(long row, void *ctx) {
+    SweepJobs *jobs = ctx;
+    MemoryTiming timing = memory_timing;
+
+    timing.page_walk_time = 50.0 + row * 450.0 / (GRID_WALK_TIMES - 1);
+    for (int t = 0; t < GRID_TLB_TIMES; t++) {
+        timing.tlb_hit_time = 1.0 + t;
+        float best = 2.0f; // Ninguna tasa basta
+        for (int h = GRID_HIT_RATES - 1; h >= 0; h--) {
+            timing.tlb_hit_rate = 0.5 + 0.5 * h / (GRID_HIT_RATES - 1);
+            if (memory_access_time_for(&timing) > GRID_TARGET_AMAT) break;
+            best = (float)timing.tlb_hit_rate;
+        }
+        jobs->min_hit_rate[row * GRID_TLB_TIMES + t] = best;
+    }
+}
+
+/**
+ * Función: shard_replay
+ * Descripción: Reproduce un trozo de la traza con un TLB vacío de una geometría.
+ */
+static void shard_replay(long job, void *ctx) {
+    SweepJobs *jobs = ctx;
+    int geometry = job / TRACE_SHARDS, shard = job % TRACE_SHARDS;
+    Tlb *tlb = tlb_create(jobs->geometries[geometry][0], jobs->geometries[geometry][1], 0);
+
+    for (long i = jobs->shard_first[shard]; i < jobs->shard_first[shard + 1]; i++) {
+        tlb_translate(tlb, jobs->pt, jobs->vpns[i]);
+    }
+    jobs->shard_misses[job] = tlb->misses;
+    tlb_destroy(tlb);
+}
+
+// Tarea raíz: lanza la rejilla y las réplicas como dos rangos
+typedef struct {
+    Task task;
+    SweepJobs *jobs;
+} SweepRoot;
+
+static void sweep_root_run(Task *task, Worker *worker) {
+    SweepJobs *jobs = ((SweepRoot *)task)->jobs;
+    pool_spawn(worker, range_task_create(0, GRID_WALK_TIMES, grid_row, jobs));
+    pool_spawn(worker, range_task_create(0, (long)jobs->num_geometries * TRACE_SHARDS, shard_replay, jobs));
+}
+
+/**
+ * Función: run_work_stealing
+ * Descripción: Ejecuta un barrido con trabajos desiguales (filas de una
+ *              rejilla de calculate_memory_access_time y réplicas de trozos
+ *              de longitud aleatoria de la traza con TLB de 64 a 512
+ *              entradas) con un trabajador y con 'num_workers', comprueba que
+ *              los resultados coinciden e informa de la utilización y los
+ *              robos de cada trabajador.
+ */
+void run_work_stealing(const Trace *trace, int num_workers) {
+    static const int geometries[][2] = {{64, 1}, {16, 4}, {1, 64}, {32, 8}, {1, 128}, {128, 4}, {1, 256}, {32, 16}};
+    const int num_geometries = sizeof(geometries) / sizeof(geometries[0]);
+    PageTable *pt = page_table_build(trace, 0.5, 0xD1B54A32D192ED03ULL);
+    unsigned int *vpns = malloc(trace->length * sizeof(unsigned int));
+    long shard_first[TRACE_SHARDS + 1];
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+    double weights[TRACE_SHARDS], total_weight = 0.0;
+
+    for (long i = 0; i < trace->length; i++) vpns[i] = virtual_page_number(decompose_address(trace->addresses[i]));
+    // Trozos de longitudes muy distintas: el peso es el cubo de un número al azar en (0, 1]
+    for (int s = 0; s < TRACE_SHARDS; s++) {
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        double u = (double)((seed >> 11) + 1) / 9007199254740992.0;
+        weights[s] = u * u * u;
+        total_weight += weights[s];
+    }
+    shard_first[0] = 0;
+    for (int s = 0; s < TRACE_SHARDS; s++) {
+        shard_first[s + 1] = s == TRACE_SHARDS - 1 ? trace->length
+                                                   : shard_first[s] + (long)(trace->length * weights[s] / total_weight);
+    }
+
+    SweepJobs results[2];
+    double elapsed[2];
+    int workers_per_run[2] = {1, num_workers};
+    WorkPool *pool = NULL;
+    for (int run = 0; run < 2; run++) {
+        results[run] = (SweepJobs){malloc(GRID_WALK_TIMES * GRID_TLB_TIMES * sizeof(float)), vpns, pt, shard_first,
+                                   geometries, num_geometries, malloc(num_geometries * TRACE_SHARDS * sizeof(long))};
+        SweepRoot root = {{sweep_root_run}, &results[run]};
+        if (pool) pool_destroy(pool);
+        pool = pool_create(workers_per_run[run]);
+        elapsed[run] = pool_run(pool, &root.task);
+    }
+
+    int same = memcmp(results[0].min_hit_rate, results[1].min_hit_rate,
+                      GRID_WALK_TIMES * GRID_TLB_TIMES * sizeof(float)) == 0 &&
+               memcmp(results[0].shard_misses, results[1].shard_misses,
+                      num_geometries * TRACE_SHARDS * sizeof(long)) == 0;
+    long shortest = trace->length, longest = 0;
+    for (int s = 0; s < TRACE_SHARDS; s++) {
+        long length = shard_first[s + 1] - shard_first[s];
+        if (length < shortest) shortest = length;
+        if (length > longest) longest = length;
+    }
+
+    printf("Robo de trabajo: rejilla de %d x %d x %d tiempos y %d trozos de traza (%ld a %ld accesos) x %d TLB\n",
+           GRID_WALK_TIMES, GRID_TLB_TIMES, GRID_HIT_RATES, TRACE_SHARDS, shortest, longest, num_geometries);
+    printf(" 1 trabajador: %.1f ms; %d trabajadores: %.1f ms (%.2fx, %ld procesadores en línea); resultados %s\n",
+           elapsed[0] / 1e6, num_workers, elapsed[1] / 1e6, elapsed[0] / elapsed[1],
+           sysconf(_SC_NPROCESSORS_ONLN), same ? "iguales" : "DISTINTOS");
+    printf(" %-11s %8s %8s %14s %12s\n", "Trabajador", "Tareas", "Robos", "Robos fallidos", "Utilización");
+    for (int w = 0; w < num_workers; w++) {
+        Worker *worker = &pool->workers[w];
+        printf(" %-11d %8ld %8ld %14ld %11.1f%%\n", w, worker->executed, worker->steals, worker->failed_steals,
+               100.0 * worker->busy_ns / elapsed[1]);
+    }
+    printf(" (Utilización: tiempo de CPU en tareas / tiempo transcurrido.)\n");
+
+    printf(" Fallos por geometría (TLB vacío al empezar cada trozo):");
+    for (int g = 0; g < num_geometries; g++) {
+        long misses = 0;
+        for (int s = 0; s < TRACE_SHARDS; s++) misses += results[1].shard_misses[g * TRACE_SHARDS + s];
+        printf(" %dx%d %.2f%%", geometries[g][0], geometries[g][1], 100.0 * misses / trace->length);
+    }
+    printf("\n Tasa de aciertos mínima para %.0f ns con TLB de %d ns:", GRID_TARGET_AMAT, TLB_HIT_TIME);
+    for (int row = GRID_WALK_TIMES / 3; row < GRID_WALK_TIMES; row += GRID_WALK_TIMES / 3) {
+        printf(" recorrido de %.0f ns %.4f", 50.0 + row * 450.0 / (GRID_WALK_TIMES - 1),
+               results[1].min_hit_rate[row * GRID_TLB_TIMES + TLB_HIT_TIME - 1]);
+    }
+    printf("\n");
+
+    for (int run = 0; run < 2; run++) {
+        free(results[run].min_hit_rate);
+        free(results[run].shard_misses);
+    }
+    pool_destroy(pool);
+    page_table_destroy(pt);
+    free(vpns);
+}
+
+/* ------------------------------------------------------------------------
+ * Simulación muestreada por fases (SimPoint)
+ * ------------------------------------------------------------------------
+ * La traza se corta en al menos SIMPOINT_MIN_INTERVALS intervalos de hasta
+ * SIMPOINT_INTERVAL accesos (las trazas cortas usan intervalos más cortos,
+ * para que simular unos pocos en detalle cueste menos que la traza). La firma de
+ * un intervalo es su vector de frecuencias de tablas y regiones (salidas de
+ * decompose_address) proyectado al azar sobre SIMPOINT_DIMENSIONS
+ * dimensiones: cada clave aporta un vector fijo con componentes en
+ * [-1, 1] que sale de un hash de su número. Las firmas se agrupan con
+ * k-means (k-means++ para empezar) y k se elige con el BIC, como SimPoint:
+ * el menor k cuyo BIC llega al 90% del rango de valores obtenidos. Sólo se
+ * simula en detalle, con un calentamiento previo del TLB, el intervalo más
+ * cercano al centro de cada grupo, y los resultados se ponderan con el
+ * tamaño de los grupos. Para estimar el error se simula además otro
+ * intervalo al azar de cada grupo: la diferencia entre los dos estima la
+ * varianza del grupo (muestreo estratificado). Los intervalos detallados no
+ * pasan de SIMPOINT_DETAILED_PERCENT de la traza: k se limita a ese
+ * presupuesto y la estimación del error se omite si no cabe en él.
+ */
+
+#define SIMPOINT_INTERVAL 20000    // Accesos máximos por intervalo
+#define SIMPOINT_MIN_INTERVAL 1000 // Accesos mínimos por intervalo
+#define SIMPOINT_MIN_INTERVALS 100 // Intervalos mínimos en que se corta la traza
+#define SIMPOINT_DETAILED_PERCENT 20 // Fracción máxima de intervalos simulados en detalle
+#define SIMPOINT_DIMENSIONS 15     // Dimensiones de la proyección de las firmas
+#define SIMPOINT_MAX_K 10          // Grupos máximos que se prueban
+#define SIMPOINT_ITERATIONS 100    // Iteraciones máximas de k-means
+#define SIMPOINT_WARMUP_DIVISOR 4  // El TLB se calienta con un cuarto de intervalo antes de medirlo
+
+// Agrupamiento de las firmas
+typedef struct {
+    int k;
+    int *cluster;           // Grupo de cada intervalo
+    double *centroids;      // k x SIMPOINT_DIMENSIONS
+    double distortion;      // Suma de distancias al cuadrado a su centro
+} Clustering;
+
+/**
+ * Función: key_projection
+ * Descripción: Componente 'dim' del vector aleatorio fijo de una clave
+ *              (tabla de nivel 1 o región), en [-1, 1].
+ */
+static inline double key_projection(unsigned int key, int dim) {
+    uint64_t h = ((uint64_t)key << 8 | dim) * 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 29; h *= 0xBF58476D1CE4E5B9ULL; h ^= h >> 32;
+    return (double)(h >> 11) / 4503599627370496.0 - 1.0;
+}
+
+/**
+ * Función: interval_signatures
+ * Descripción: Firma de cada intervalo: frecuencias de sus tablas de nivel
+ *              1 y, con la mitad de peso, de sus regiones de 1MB (índices de
+ *              nivel 1 y 2), proyectadas. Las frecuencias de páginas sueltas
+ *              no sirven: con un conjunto de trabajo grande su proyección es
+ *              casi nula para cualquier patrón de acceso.
+ */
+static double *interval_signatures(const Trace *trace, int intervals, long interval_length) {
+    double *signatures = calloc((size_t)intervals * SIMPOINT_DIMENSIONS, sizeof(double));
+    int *regions = calloc(16 * 256, sizeof(int)), *tables = calloc(16, sizeof(int));
+
+    for (int n = 0; n < intervals; n++) {
+        double *signature = signatures + n * SIMPOINT_DIMENSIONS;
+        long first = n * interval_length;
+        long last = first + interval_length < trace->length ? first + interval_length : trace->length;
+        for (long i = first; i < last; i++) {
+            VirtualAddress addr = decompose_address(trace->addresses[i]);
+            tables[addr.lvl1_index]++;
+            regions[addr.lvl1_index << 8 | addr.lvl2_index]++;
+        }
+        for (unsigned int key = 0; key < 16 * 256; key++) {
+            double weight = 0.5 * regions[key] / (last - first);
+            for (int d = 0; d < SIMPOINT_DIMENSIONS && regions[key]; d++) signature[d] += weight * key_projection(key, d);
+            regions[key] = 0;
+        }
+        for (unsigned int table = 0; table < 16; table++) {
+            double weight = (double)tables[table] / (last - first);
+            for (int d = 0; d < SIMPOINT_DIMENSIONS && tables[table]; d++) {
+                signature[d] += weight * key_projection(1u << 16 | table, d);
+            }
+            tables[table] = 0;
+        }
+    }
+    free(regions);
+    free(tables);
+    return signatures;
+}
+
+static double squared_distance(const double *a, const double *b) {
+    double sum = 0.0;
+    for (int d = 0; d < SIMPOINT_DIMENSIONS; d++) sum += (a[d] - b[d]) * (a[d] - b[d]);
+    return sum;
+}
+
+/**
+ * Función: kmeans
+ * Descripción: Agrupa 'count' firmas en k grupos: centros iniciales con
+ *              k-means++ y después iteraciones de Lloyd hasta que ningún
+ *              intervalo cambia de grupo.
+ */
+static Clustering kmeans(const double *points, int count, int k, uint64_t seed) {
+    Clustering c = {k, calloc(count, sizeof(int)), malloc((size_t)k * SIMPOINT_DIMENSIONS * sizeof(double)), 0.0};
+    double *nearest = malloc(count * sizeof(double));
+
+    // k-means++: cada centro nuevo se elige con probabilidad proporcional a la distancia al cuadrado
+    memcpy(c.centroids, points + (seed % count) * SIMPOINT_DIMENSIONS, SIMPOINT_DIMENSIONS * sizeof(double));
+    for (int j = 1; j < k; j++) {
+        double total = 0.0;
+        for (int n = 0; n < count; n++) {
+            nearest[n] = squared_distance(points + n * SIMPOINT_DIMENSIONS, c.centroids);
+            for (int m = 1; m < j; m++) {
+                double dist = squared_distance(points + n * SIMPOINT_DIMENSIONS, c.centroids + m * SIMPOINT_DIMENSIONS);
+                if (dist < nearest[n]) nearest[n] = dist;
+            }
+            total += nearest[n];
+        }
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        double target = total * (double)(seed >> 11) / 9007199254740992.0;
+        int chosen = 0;
+        for (; chosen < count - 1 && (target -= nearest[chosen]) > 0; chosen++);
+        memcpy(c.centroids + j * SIMPOINT_DIMENSIONS, points + chosen * SIMPOINT_DIMENSIONS,
+               SIMPOINT_DIMENSIONS * sizeof(double));
+    }
+
+    for (int iteration = 0; iteration < SIMPOINT_ITERATIONS; iteration++) {
+        int changed = iteration == 0;
+        c.distortion = 0.0;
+        for (int n = 0; n < count; n++) {
+            int best = 0;
+            double best_dist = squared_distance(points + n * SIMPOINT_DIMENSIONS, c.centroids);
+            for (int j = 1; j < k; j++) {
+                double dist = squared_distance(points + n * SIMPOINT_DIMENSIONS, c.centroids + j * SIMPOINT_DIMENSIONS);
+                if (dist < best_dist) {
+                    best = j;
+                    best_dist = dist;
+                }
+            }
+            changed |= c.cluster[n] != best;
+            c.cluster[n] = best;
+            c.distortion += best_dist;
+        }
+        if (!changed) break;
+        // Cada centro pasa a la media de sus intervalos (un grupo vacío conserva su centro)
+        for (int j = 0; j < k; j++) {
+            double sum[SIMPOINT_DIMENSIONS] = {0};
+            int members = 0;
+            for (int n = 0; n < count; n++) {
+                if (c.cluster[n] != j) continue;
+                members++;
+                for (int d = 0; d < SIMPOINT_DIMENSIONS; d++) sum[d] += points[n * SIMPOINT_DIMENSIONS + d];
+            }
+            for (int d = 0; d < SIMPOINT_DIMENSIONS && members; d++) c.centroids[j * SIMPOINT_DIMENSIONS + d] = sum[d] / members;
+        }
+    }
+    free(nearest);
+    return c;
+}
+
+/**
+ * Función: clustering_bic
+ * Descripción: BIC de un agrupamiento con el modelo de X-means: mezcla de
+ *              gaussianas esféricas con una varianza común.
+ */
+static double clustering_bic(const Clustering *c, int count) {
+    double dims = SIMPOINT_DIMENSIONS, variance = c->distortion / (dims * (count - c->k > 0 ? count - c->k : 1));
+    double likelihood = 0.0;
+
+    if (variance <= 0.0) variance = 1e-300;
+    for (int j = 0; j < c->k; j++) {
+        double members = 0;
+        for (int n = 0; n < count; n++) members += c->cluster[n] == j;
+        if (members == 0) continue;
+        likelihood += members * log(members / count) - members * dims / 2 * log(2 * 3.14159265358979 * variance) -
+                      (members - 1) * dims / 2;
+    }
+    return likelihood - c->k * (dims + 1) / 2 * log(count);
+}
+
+/**
+ * Función: simulate_interval
+ * Descripción: Simulación detallada de un intervalo con un TLB de 16x4
+ *              calentado con el cuarto de intervalo anterior.
+ * Retorno:
+ *   - Tasa de fallos del intervalo.
+ */
+static double simulate_interval(const unsigned int *vpns, long length, int interval, long interval_length,
+                                const PageTable *pt) {
+    long first = interval * interval_length, warmup = interval_length / SIMPOINT_WARMUP_DIVISOR;
+    long last = first + interval_length < length ? first + interval_length : length;
+    Tlb *tlb = tlb_create(16, 4, 0);
+
+    for (long i = first > warmup ? first - warmup : 0; i < first; i++) tlb_translate(tlb, pt, vpns[i]);
+    tlb->accesses = tlb->misses = 0;
+    for (long i = first; i < last; i++) tlb_translate(tlb, pt, vpns[i]);
+    double rate = (double)tlb->misses / tlb->accesses;
+    tlb_destroy(tlb);
+    return rate;
+}
+
+/**
+ * Función: amat_for_miss_rate
+ * Descripción: calculate_memory_access_time con una tasa de fallos dada.
+ */
+static double amat_for_miss_rate(double miss_rate) {
+    MemoryTiming timing = memory_timing;
+    timing.tlb_hit_rate = 1.0 - miss_rate;
+    return memory_access_time_for(&timing);
+}
+
+/**
+ * Función: simpoint_report
+ * Descripción: Muestreo por fases de una traza comparado con su simulación
+ *              detallada completa.
+ */
+static void simpoint_report(const Trace *trace, const char *title) {
+    long interval_length = trace->length / SIMPOINT_MIN_INTERVALS;
+    if (interval_length > SIMPOINT_INTERVAL) interval_length = SIMPOINT_INTERVAL;
+    if (interval_length < SIMPOINT_MIN_INTERVAL) interval_length = SIMPOINT_MIN_INTERVAL;
+    int intervals = (int)((trace->length + interval_length - 1) / interval_length);
+    int budget = intervals * SIMPOINT_DETAILED_PERCENT / 100; // Intervalos que se pueden simular en detalle
+    if (budget < 1) budget = 1;
+    PageTable *pt = page_table_build(trace, 0.5, 0xD1B54A32D192ED03ULL);
+    unsigned int *vpns = malloc(trace->length * sizeof(unsigned int));
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+
+    printf("%s: %ld accesos en %d intervalos de %ld\n", title, trace->length, intervals, interval_length);
+    if (intervals < 2) {
+        printf(" Hacen falta al menos dos intervalos\n");
+        page_table_destroy(pt);
+        free(vpns);
+        return;
+    }
+
+    // Firmas y agrupamiento: una pasada rápida sobre la traza
+    double start = now_ns();
+    for (long i = 0; i < trace->length; i++) vpns[i] = virtual_page_number(decompose_address(trace->addresses[i]));
+    double *signatures = interval_signatures(trace, intervals, interval_length);
+    int max_k = budget < SIMPOINT_MAX_K ? budget : SIMPOINT_MAX_K;
+    Clustering clusterings[SIMPOINT_MAX_K];
+    double bic[SIMPOINT_MAX_K], bic_min = 0.0, bic_max = 0.0;
+    for (int k = 1; k <= max_k; k++) {
+        clusterings[k - 1] = kmeans(signatures, intervals, k, seed + k);
+        bic[k - 1] = clustering_bic(&clusterings[k - 1], intervals);
+        if (k == 1 || bic[k - 1] < bic_min) bic_min = bic[k - 1];
+        if (k == 1 || bic[k - 1] > bic_max) bic_max = bic[k - 1];
+    }
+    int chosen = 0;
+    while (bic[chosen] < bic_min + 0.9 * (bic_max - bic_min)) chosen++;
+    Clustering *c = &clusterings[chosen];
+    double profile_ns = now_ns() - start;
+
+    // Simulación detallada del representante de cada grupo y de otro intervalo al azar del grupo
+    start = now_ns();
+    double estimate = 0.0, variance = 0.0;
+    long simulated = 0;
+    int estimate_error = 2 * c->k <= budget; // El otro intervalo de cada grupo duplica el trabajo detallado
+    printf(" Grupos elegidos con el BIC: %d\n", c->k);
+    printf(" %-6s %10s %8s %13s %11s %11s\n", "Grupo", "Intervalos", "Peso", "Representante", "Fallos", "Otro");
+    for (int j = 0; j < c->k; j++) {
+        int members = 0, representative = -1, other = -1;
+        double best = 0.0;
+        for (int n = 0; n < intervals; n++) {
+            if (c->cluster[n] != j) continue;
+            double dist = squared_distance(signatures + n * SIMPOINT_DIMENSIONS, c->centroids + j * SIMPOINT_DIMENSIONS);
+            if (representative < 0 || dist < best) {
+                representative = n;
+                best = dist;
+            }
+            members++;
+        }
+        if (members == 0) continue;
+        double weight = (double)members / intervals;
+        double rate = simulate_interval(vpns, trace->length, representative, interval_length, pt);
+        simulated++;
+        estimate += weight * rate;
+        if (members > 1 && estimate_error) {
+            // Otro miembro al azar: (x1 - x2)^2 / 2 estima la varianza del grupo
+            seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+            int pick = seed % (members - 1);
+            for (int n = 0; n < intervals; n++) {
+                if (c->cluster[n] != j || n == representative) continue;
+                if (pick-- == 0) {
+                    other = n;
+                    break;
+                }
+            }
+            double other_rate = simulate_interval(vpns, trace->length, other, interval_length, pt);
+            simulated++;
+            variance += weight * weight * (rate - other_rate) * (rate - other_rate) / 2;
+            printf(" %-6d %10d %7.1f%% %13d %10.2f%% %10.2f%%\n", j, members, 100.0 * weight,
+                   representative, 100.0 * rate, 100.0 * other_rate);
+        } else {
+            printf(" %-6d %10d %7.1f%% %13d %10.2f%% %11s\n", j, members, 100.0 * weight,
+                   representative, 100.0 * rate, "-");
+        }
+    }
+    double sampled_ns = now_ns() - start;
+
+    // Referencia: la simulación detallada de toda la traza
+    start = now_ns();
+    Tlb *tlb = tlb_create(16, 4, 0);
+    for (long i = 0; i < trace->length; i++) tlb_translate(tlb, pt, vpns[i]);
+    double full_rate = (double)tlb->misses / tlb->accesses;
+    tlb_destroy(tlb);
+    double full_ns = now_ns() - start;
+
+    double error = 2.0 * sqrt(variance); // Unos dos errores típicos (95%)
+    double amat_slope = memory_timing.page_walk_time - memory_timing.tlb_hit_time;
+    if (estimate_error) {
+        printf(" Tasa de fallos: muestreada %.3f%% ± %.3f%%, completa %.3f%% (diferencia %.3f%%)\n", 100.0 * estimate,
+               100.0 * error, 100.0 * full_rate, 100.0 * (estimate - full_rate));
+        printf(" AMAT: muestreado %.2f ns ± %.2f ns, completo %.2f ns\n", amat_for_miss_rate(estimate),
+               error * amat_slope, amat_for_miss_rate(full_rate));
+    } else {
+        printf(" Tasa de fallos: muestreada %.3f%% (sin estimación de error), completa %.3f%% (diferencia %.3f%%)\n",
+               100.0 * estimate, 100.0 * full_rate, 100.0 * (estimate - full_rate));
+        printf(" AMAT: muestreado %.2f ns, completo %.2f ns\n", amat_for_miss_rate(estimate),
+               amat_for_miss_rate(full_rate));
+    }
+    printf(" Tiempo: firmas y k-means %.1f ms; %ld intervalos en detalle (%.1f%% de la traza) %.1f ms;"
+           " traza completa %.1f ms\n", profile_ns / 1e6, simulated,
+           100.0 * simulated * interval_length / trace->length, sampled_ns / 1e6, full_ns / 1e6);
+    printf(" Aceleración: %.1fx la simulación detallada, %.1fx contando las firmas\n", full_ns / sampled_ns,
+           full_ns / (profile_ns + sampled_ns));
+
+    for (int k = 0; k < max_k; k++) {
+        free(clusterings[k].cluster);
+        free(clusterings[k].centroids);
+    }
+    free(signatures);
+    page_table_destroy(pt);
+    free(vpns);
+}
+
+/**
+ * Función: trace_generate_phased
+ * Descripción: Traza con fases: tramos de entre uno y ocho intervalos (no
+ *              alineados con ellos) en los que domina uno de cuatro
+ *              comportamientos (vector secuencial, montículo aleatorio,
+ *              lista enlazada y estructuras de 3 páginas), con un 20% de
+ *              accesos al código en todos.
+ */
+Trace trace_generate_phased(long length, uint64_t seed) {
+    Trace trace = {malloc(length * sizeof(unsigned int)), NULL, length};
+    unsigned int cursor = 0;
+    long phase_end = 0;
+    int phase = 0;
+
+    for (long i = 0; i < length; i++) {
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        unsigned int r = (unsigned int)(seed >> 32);
+        if (i == phase_end) {
+            phase = r % 4;
+            phase_end = i + SIMPOINT_INTERVAL / 2 * (2 + r / 4 % 15);
+        }
+        if (r % 5 == 0) {
+            trace.addresses[i] = 0x00400000u + (r >> 8) % (16 * PAGE_SIZE);
+            continue;
+        }
+        switch (phase) {
+        case 0: trace.addresses[i] = 0x10000000u + (cursor += CACHE_LINE_SIZE) % (2048u * PAGE_SIZE); break;
+        case 1: trace.addresses[i] = 0x20000000u + (r >> 4) % (4096u * PAGE_SIZE); break;
+        case 2: trace.addresses[i] = 0x30000000u + (i / 4 * 7 % 4096) * PAGE_SIZE + (r >> 8) % PAGE_SIZE; break;
+        default: trace.addresses[i] = 0x40000000u + (cursor += 3 * PAGE_SIZE) % (6144u * PAGE_SIZE); break;
+        }
+    }
+    return trace;
+}
+
+/**
+ * Función: run_simpoint
+ * Descripción: Muestreo por fases de la traza dada y de una traza con fases de la misma longitud.
+ */
+void run_simpoint(const Trace *trace) {
+    Trace phased = trace_generate_phased(trace->length, 0x9E3779B97F4A7C15ULL);
+    simpoint_report(trace, "Traza");
+    printf("\n");
+    simpoint_report(&phased, "Traza con fases");
+    trace_free(&phased);
+}
+
+/* ------------------------------------------------------------------------
+ * Muestreo estadístico con calentamiento funcional (SMARTS)
+ * ------------------------------------------------------------------------
+ * La réplica detallada es la simulación por eventos (ventana de accesos,
+ * MSHR, canales de DRAM e intercambio). El muestreo sólo la usa en
+ * ventanas cortas de SMARTS_UNIT accesos, precedidas de SMARTS_DETAILED_WARMUP
+ * accesos detallados que no se miden (llenan la ventana y los MSHR). El
+ * resto de la traza se avanza con calentamiento funcional, sin tiempos:
+ *   - El estado de larga memoria (qué páginas ya se trajeron del
+ *     intercambio) sale de una pasada que apunta el primer acceso a cada
+ *     página; con él se sabe el estado de cualquier página en cualquier
+ *     punto de la traza.
+ *   - El TLB sólo recuerda sus últimas páginas, así que se calienta con
+ *     tlb_translate sobre los SMARTS_TLB_WARMUP accesos anteriores.
+ * Como ninguna ventana depende de las anteriores, se simulan en orden
+ * aleatorio y la estimación es válida desde las primeras: en cuanto el
+ * intervalo de confianza baja de la precisión pedida se para. Los fallos
+ * del intercambio son raros y muy largos, así que una muestra simple casi
+ * nunca los ve; la pasada funcional dice qué ventanas alcanzan, y éstas
+ * forman un estrato aparte (muestreo estratificado).
+ * Cada ventana cuesta unos 2000 accesos detallados y 2000 funcionales, y
+ * para ±3% bastan del orden de un centenar de ventanas, así que el coste del
+ * muestreo apenas depende de la longitud de la traza: con la traza sintética
+ * es unas 6 veces más rápido que la réplica completa con 2 millones de
+ * accesos y supera las 10 veces a partir de unos 4 millones. Con trazas muy
+ * largas manda la pasada funcional, que recorre toda la traza, y la ganancia
+ * se estabiliza en torno a 30 veces. Si la ganancia medida queda por debajo
+ * de SMARTS_TARGET_SPEEDUP se avisa: la traza es demasiado corta para que
+ * el muestreo compense.
+ */
+
+#define SMARTS_UNIT 1000               // Accesos medidos por ventana
+#define SMARTS_DETAILED_WARMUP 1000    // Accesos detallados sin medir antes de cada ventana
+#define SMARTS_TLB_WARMUP 2000         // Accesos de calentamiento funcional del TLB (de 64 entradas)
+#define SMARTS_MIN_WINDOWS 15          // Ventanas mínimas por estrato antes de fiarse de la varianza
+#define SMARTS_Z 3.0                   // Intervalo de confianza del 99,7%
+#define SMARTS_DEFAULT_PRECISION 3.0   // Semiamplitud pedida, en % de la media
+#define SMARTS_SWAP_FRACTION 0.01      // Páginas en el intercambio al empezar
+#define SMARTS_TARGET_SPEEDUP 10.0     // Ganancia mínima esperada frente a la réplica completa
+
+// Núcleo de una ventana detallada: sólo se mide a partir de 'measure_from'
+typedef struct {
+    SimCore core;
+    long *slot_index;       // Posición en la traza del acceso de cada hueco de la ventana
+    long measure_from;
+    long measured;
+    uint64_t latency;       // Ticks de los accesos medidos, sumados
+} SmartsWindow;
+
+/**
+ * Función: smarts_data
+ * Descripción: Como core_data, pero sólo suma la latencia de los accesos medidos.
+ */
+static void smarts_data(EventWheel *wheel, void *ctx, uint64_t arg) {
+    SmartsWindow *window = ctx;
+    SimCore *core = &window->core;
+    MemRequest *req = (MemRequest *)(uintptr_t)arg;
+    long slot = req - core->requests;
+
+    if (window->slot_index[slot] >= window->measure_from) {
+        window->measured++;
+        window->latency += wheel->now - req->issued;
+    }
+    core->completed++;
+    if (core->next < core->end) {
+        window->slot_index[slot] = core->next;
+        req->vpn = core->vpns[core->next++];
+        timed_access(&core->mmu, req);
+    }
+}
+
+/**
+ * Función: detailed_latency
+ * Descripción: Simulación por eventos de los accesos [first, last) con un
+ *              TLB ya preparado, midiendo desde 'measure_from'.
+ * Retorno:
+ *   - Latencia media de los accesos medidos en ns.
+ */
+static double detailed_latency(EventWheel *wheel, const unsigned int *vpns, long first, long last,
+                               long measure_from, const PageTable *pt, Tlb *tlb, SwapDevice *swap) {
+    DramModel dram = {{0}, DRAM_CHANNELS, 0, 0};
+    SmartsWindow window = {.slot_index = calloc(MLP_WINDOW, sizeof(long)), .measure_from = measure_from};
+    SimCore *core = &window.core;
+
+    mmu_init(&core->mmu, wheel, pt, &dram, swap, 4);
+    tlb_destroy(core->mmu.tlb);
+    core->mmu.tlb = tlb;
+    core->vpns = vpns;
+    core->next = first;
+    core->end = last;
+    core->requests = calloc(MLP_WINDOW, sizeof(MemRequest));
+    for (int w = 0; w < MLP_WINDOW && core->next < core->end; w++) {
+        MemRequest *req = &core->requests[w];
+        window.slot_index[w] = core->next;
+        *req = (MemRequest){vpns[core->next++], 0, smarts_data, &window, (uintptr_t)req, NULL};
+        timed_access(&core->mmu, req);
+    }
+    wheel_run(wheel);
+    free(core->requests);
+    free(window.slot_index);
+    return window.measured ? (double)window.latency / window.measured / EVENT_TICKS_PER_NS : 0.0;
+}
+
+// Estrato de ventanas: las que alcanza algún fallo del intercambio o las demás
+typedef struct {
+    long *units;            // Ventanas del estrato en orden aleatorio
+    long size;
+    long n;                 // Ventanas simuladas
+    double mean, m2;        // Media y suma de cuadrados de Welford
+} SmartsStratum;
+
+/**
+ * Función: smarts_next_stratum
+ * Descripción: Estrato de la siguiente ventana: primero hasta tener
+ *              SMARTS_MIN_WINDOWS en cada uno y después el que más reduce
+ *              la varianza del estimador (asignación de Neyman voraz).
+ * Retorno:
+ *   - El estrato, o NULL si ya se simularon todas las ventanas.
+ */
+static SmartsStratum *smarts_next_stratum(SmartsStratum *strata, long units) {
+    SmartsStratum *best = NULL;
+    double best_gain = -1.0;
+
+    for (int h = 0; h < 2; h++) {
+        SmartsStratum *stratum = &strata[h];
+        if (stratum->n >= stratum->size) continue;
+        if (stratum->n < SMARTS_MIN_WINDOWS) return stratum;
+        double weight = (double)stratum->size / units;
+        double gain = weight * weight * stratum->m2 / (stratum->n - 1) / stratum->n / (stratum->n + 1);
+        if (gain > best_gain) {
+            best = stratum;
+            best_gain = gain;
+        }
+    }
+    return best;
+}
+
+/**
+ * Función: run_smarts
+ * Descripción: Estima la latencia media de acceso de la simulación por
+ *              eventos con ventanas detalladas elegidas al azar hasta que el
+ *              intervalo de confianza baja de 'precision' (% de la media), y
+ *              la compara con la réplica detallada de toda la traza.
+ */
+void run_smarts(const Trace *trace, double precision) {
+    PageTable *pt = page_table_build(trace, 0.5, 0xD1B54A32D192ED03ULL);
+    unsigned int *vpns = malloc(trace->length * sizeof(unsigned int));
+    long units = trace->length / SMARTS_UNIT;
+    EventWheel *wheel = wheel_create();
+    SwapDevice swap;
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+
+    if (units < 2) {
+        printf("La traza es demasiado corta: hacen falta al menos %d accesos\n", 2 * SMARTS_UNIT);
+        page_table_destroy(pt);
+        free(vpns);
+        wheel_destroy(wheel);
+        return;
+    }
+    printf("SMARTS: %ld accesos, ventanas de %d accesos tras %d detallados y %d funcionales de TLB\n",
+           trace->length, SMARTS_UNIT, SMARTS_DETAILED_WARMUP, SMARTS_TLB_WARMUP);
+    printf(" Objetivo: ±%.1f%% con z = %.1f; simulación por eventos con ventana de %d, 4 MSHR, %d canales y %.0f%% en el intercambio\n",
+           precision, SMARTS_Z, MLP_WINDOW, DRAM_CHANNELS, 100.0 * SMARTS_SWAP_FRACTION);
+
+    // Calentamiento funcional de larga memoria: primer acceso a cada página
+    double start = now_ns();
+    long *first_touch = malloc((1 << 20) * sizeof(long)); // -1 si la página no aparece en la traza
+    memset(first_touch, 0xFF, (1 << 20) * sizeof(long));
+    for (long i = 0; i < trace->length; i++) {
+        vpns[i] = virtual_page_number(decompose_address(trace->addresses[i]));
+        if (first_touch[vpns[i]] == -1) first_touch[vpns[i]] = i;
+    }
+    swap_init(&swap, SMARTS_SWAP_FRACTION);
+    uint8_t *initially_resident = malloc(1 << 20);
+    memcpy(initially_resident, swap.resident, 1 << 20);
+    // Estratos: ventanas a las que alcanza la primera lectura de una página del intercambio y el resto
+    uint8_t *faulting = calloc(units, 1);
+    for (uint32_t vpn = 0; vpn < (1u << 20); vpn++) {
+        if (first_touch[vpn] == -1 || initially_resident[vpn]) continue;
+        for (long u = first_touch[vpn] / SMARTS_UNIT; u <= (first_touch[vpn] + SMARTS_DETAILED_WARMUP) / SMARTS_UNIT && u < units; u++) {
+            faulting[u] = 1;
+        }
+    }
+    SmartsStratum strata[2] = {{0}};
+    for (int h = 0; h < 2; h++) strata[h].units = malloc(units * sizeof(long));
+    for (long u = 0; u < units; u++) {
+        SmartsStratum *stratum = &strata[faulting[u]];
+        stratum->units[stratum->size++] = u;
+    }
+    for (int h = 0; h < 2; h++) {
+        for (long u = strata[h].size - 1; u > 0; u--) {
+            seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+            long other = seed % (u + 1), unit = strata[h].units[u];
+            strata[h].units[u] = strata[h].units[other];
+            strata[h].units[other] = unit;
+        }
+    }
+    double prepare_ns = now_ns() - start;
+
+    // Ventanas al azar dentro de cada estrato hasta alcanzar la precisión
+    start = now_ns();
+    long n = 0;
+    double mean = 0.0, half_width = 0.0;
+    int reached = 0;
+    printf(" Estratos: %ld ventanas sin fallos del intercambio y %ld alcanzadas por alguno\n", strata[0].size,
+           strata[1].size);
+    printf(" %8s %12s %12s\n", "Ventanas", "Media", "± (z)");
+    for (;;) {
+        SmartsStratum *stratum = smarts_next_stratum(strata, units);
+        if (stratum == NULL) break;
+        long first = stratum->units[stratum->n] * SMARTS_UNIT, last = first + SMARTS_UNIT;
+        long detail = first > SMARTS_DETAILED_WARMUP ? first - SMARTS_DETAILED_WARMUP : 0;
+        long warm = detail > SMARTS_TLB_WARMUP ? detail - SMARTS_TLB_WARMUP : 0;
+
+        Tlb *tlb = tlb_create(16, 4, 0);
+        for (long i = warm; i < detail; i++) tlb_translate(tlb, pt, vpns[i]);
+        for (long i = detail; i < last; i++) {
+            swap.resident[vpns[i]] = initially_resident[vpns[i]] || (first_touch[vpns[i]] != -1 && first_touch[vpns[i]] < detail);
+        }
+        double x = detailed_latency(wheel, vpns, detail, last, first, pt, tlb, &swap);
+        tlb_destroy(tlb);
+
+        // Media y varianza de Welford del estrato
+        stratum->n++;
+        double delta = x - stratum->mean;
+        stratum->mean += delta / stratum->n;
+        stratum->m2 += delta * (x - stratum->mean);
+        n++;
+
+        // Estimador estratificado con corrección de población finita
+        double variance = 0.0;
+        int enough = 1;
+        mean = 0.0;
+        for (int h = 0; h < 2; h++) {
+            if (strata[h].size == 0) continue;
+            double weight = (double)strata[h].size / units;
+            mean += weight * strata[h].mean;
+            if (strata[h].n > 1) {
+                variance += weight * weight * strata[h].m2 / (strata[h].n - 1) / strata[h].n *
+                            (1.0 - (double)strata[h].n / strata[h].size);
+            }
+            enough &= strata[h].n >= (strata[h].size < SMARTS_MIN_WINDOWS ? strata[h].size : SMARTS_MIN_WINDOWS);
+        }
+        half_width = SMARTS_Z * sqrt(variance);
+        if ((n & (n - 1)) == 0 && n >= 8) printf(" %8ld %9.2f ns %9.2f ns\n", n, mean, half_width);
+        if (enough && half_width <= precision / 100.0 * mean) {
+            reached = 1;
+            break;
+        }
+    }
+    double sampled_ns = now_ns() - start;
+
+    // Referencia: la réplica detallada de toda la traza
+    start = now_ns();
+    Tlb *tlb = tlb_create(16, 4, 0);
+    memcpy(swap.resident, initially_resident, 1 << 20);
+    double full = detailed_latency(wheel, vpns, 0, trace->length, 0, pt, tlb, &swap);
+    tlb_destroy(tlb);
+    double full_ns = now_ns() - start;
+
+    printf(" AMAT muestreado: %.2f ns ± %.2f ns (±%.2f%%) con %ld ventanas, %ld con fallos (%.2f%% de la traza en detalle)%s\n",
+           mean, half_width, 100.0 * half_width / mean, n, strata[1].n,
+           100.0 * n * (SMARTS_UNIT + SMARTS_DETAILED_WARMUP) / trace->length,
+           reached ? "" : "; no se alcanzó la precisión");
+    printf(" AMAT de la réplica detallada completa: %.2f ns (diferencia %+.2f%%, %s del intervalo)\n", full,
+           100.0 * (mean - full) / full, fabs(mean - full) <= half_width ? "dentro" : "fuera");
+    printf(" Tiempo: calentamiento funcional %.1f ms + ventanas %.1f ms; réplica completa %.1f ms (%.1fx)\n",
+           prepare_ns / 1e6, sampled_ns / 1e6, full_ns / 1e6, full_ns / (prepare_ns + sampled_ns));
+    if (full_ns / (prepare_ns + sampled_ns) < SMARTS_TARGET_SPEEDUP) {
+        printf(" Aviso: ganancia por debajo de %.0fx; el coste fijo de las ventanas pesa demasiado con %ld accesos\n",
+               SMARTS_TARGET_SPEEDUP, trace->length);
+    }
+
+    for (int h = 0; h < 2; h++) free(strata[h].units);
+    free(faulting);
+    free(initially_resident);
+    free(first_touch);
+    free(swap.resident);
+    wheel_destroy(wheel);
+    page_table_destroy(pt);
+    free(vpns);
+}
+
+/**
+ * Función: count_argument
+ * Descripción: Lee el contador opcional de argv[index] (hilos o trabajadores).
+ * Retorno:
+ *   - El número, el valor por defecto si no se indicó, o -1 si argv[index] no
+ *     es un entero positivo.
+ */
+static long count_argument(int argc, char *argv[], int index, long default_count) {
+    if (argc <= index) return default_count;
+    char *end;
+    long count = strtol(argv[index], &end, 10);
+    if (end == argv[index] || *end != '\0' || count <= 0) return -1;
+    return count;
+}
+
+/*
+ * Función principal:
+ *    - Con el argumento "calibrate" mide los tiempos del anfitrión y termina.
+ *    - Carga los tiempos calibrados de TIMING_CONFIG_FILE si existe.
+ *    - Con el nombre de un modo de simulación reproduce una traza y termina.
+ *    - Solicita al usuario ingresar una dirección virtual en hexadecimal.
+ *    - Descompone la dirección en sus índices de tabla y el offset correspondiente.
+ *    - Calcula y muestra el tiempo promedio de acceso a memoria.
+ */
+
+int main(int argc, char *argv[]) {
+    unsigned int virtual_address;
+
+    if (argc > 1 && strcmp(argv[1], "calibrate") == 0) {
+        return run_calibration() ? 0 : 1;
+    }
+    if (load_timing_config(TIMING_CONFIG_FILE)) {
+        printf("Usando los tiempos calibrados de %s\n", TIMING_CONFIG_FILE);
+    }
+    if (argc > 1 && strcmp(argv[1], "coalesce") == 0) {
+        Trace trace;
+        if (!trace_open(argc, argv, &trace)) return 1;
+        run_coalescing_comparison(&trace);
+        trace_free(&trace);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "lookup") == 0) {
+        Trace trace;
+        if (!trace_open(argc, argv, &trace)) return 1;
+        run_lookup_benchmark(&trace);
+        trace_free(&trace);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "sweep") == 0) {
+        Trace trace;
+        if (!trace_open(argc, argv, &trace)) return 1;
+        run_allassoc_sweep(&trace);
+        trace_free(&trace);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "tournament") == 0) {
+        Trace trace;
+        if (!trace_open(argc, argv, &trace)) return 1;
+        run_tournament(&trace);
+        trace_free(&trace);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "prefetch") == 0) {
+        Trace trace;
+        if (!trace_open(argc, argv, &trace)) return 1;
+        run_prefetch_comparison(&trace);
+        trace_free(&trace);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "conflict") == 0) {
+        Trace trace;
+        if (!trace_open(argc, argv, &trace)) return 1;
+        run_conflict_comparison(&trace);
+        trace_free(&trace);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "mshr") == 0) {
+        Trace trace;
+        if (!trace_open(argc, argv, &trace)) return 1;
+        run_nonblocking_comparison(&trace);
+        trace_free(&trace);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "events") == 0) {
+        Trace trace;
+        if (!trace_open(argc, argv, &trace)) return 1;
+        run_event_simulation(&trace);
+        trace_free(&trace);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "coroutines") == 0) {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        long max_hosts = COROUTINE_HOSTS_PER_CPU * (processors > 1 ? processors : 1);
+        long num_threads = count_argument(argc, argv, 2, COROUTINE_DEFAULT_THREADS);
+        long host_threads = count_argument(argc, argv, 3, 2);
+        if (num_threads < 0 || num_threads > COROUTINE_MAX_THREADS) {
+            fprintf(stderr, "El número de hilos simulados debe ser un entero entre 1 y %d\n", COROUTINE_MAX_THREADS);
+            return 1;
+        }
+        if (host_threads < 0 || host_threads > max_hosts) {
+            fprintf(stderr, "El número de hilos anfitriones debe ser un entero entre 1 y %ld\n", max_hosts);
+            return 1;
+        }
+        run_coroutine_threads((int)num_threads, (int)host_threads);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "pool") == 0) {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        long num_workers = count_argument(argc, argv, 3, processors > POOL_MIN_WORKERS ? processors : POOL_MIN_WORKERS);
+        if (num_workers < 0 || num_workers > POOL_MAX_WORKERS) {
+            fprintf(stderr, "El número de trabajadores debe ser un entero entre 1 y %d\n", POOL_MAX_WORKERS);
+            return 1;
+        }
+        Trace trace;
+        if (!trace_open(argc, argv, &trace)) return 1;
+        run_work_stealing(&trace, (int)num_workers);
+        trace_free(&trace);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "simpoint") == 0) {
+        Trace trace;
+        if (!trace_open(argc, argv, &trace)) return 1;
+        run_simpoint(&trace);
+        trace_free(&trace);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "smarts") == 0) {
+        double precision = SMARTS_DEFAULT_PRECISION;
+        if (argc > 3) {
+            char *end;
+            precision = strtod(argv[3], &end);
+            if (end == argv[3] || *end != '\0' || !(precision > 0.0) || isinf(precision)) {
+                fprintf(stderr, "La precisión debe ser un porcentaje positivo\n");
+                return 1;
+            }
+        }
+        Trace trace;
+        if (!trace_open(argc, argv, &trace)) return 1;
+        run_smarts(&trace, precision);
+        trace_free(&trace);
+        return 0;
+    }
 
     // Solicita al usuario ingresar una dirección virtual en formato hexadecimal (hasta 36 bits)
     printf("Ingrese una dirección virtual (en hexadecimal, hasta 36 bits): ");
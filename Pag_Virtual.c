@@ -10,32 +10,105 @@
  * página. A partir de la dirección virtual proporcionada por el usuario, el programa calcula el 
  * número de página y el offset dentro de la página, y luego intenta acceder a la tabla de páginas 
  * para determinar si la página está en memoria física o en swap.
+ *
+ * Además incluye un asignador de bloques de swap por clusters (modo "swap-bench") y un
+ * simulador de paginación por demanda sobre los 2^21 bytes de memoria física, con reemplazo
+ * por reloj y una caché comprimida en memoria entre la RAM y el swap (modo "zswap"). La
+ * memoria física puede dividirse en dos niveles (DRAM y memoria lejana tipo CXL) con
+ * migración de páginas calientes y frías (modo "tiers"). Además del reloj global, el motor
+ * de reemplazo ofrece las políticas de conjunto de trabajo WS(τ) y de frecuencia de fallos
+ * de página PFF (modo "ws"). Con varios procesos compitiendo por los marcos, un planificador
+ * a medio plazo detecta la hiperpaginación y suspende procesos completos (modo "thrashing").
+ * Un hilo reclamador en segundo plano mantiene los marcos libres entre dos marcas de agua
+ * para que los fallos casi nunca tengan que reclamar memoria por sí mismos (modo "kswapd").
+ * También simula fork con copia en escritura sobre tablas de páginas de dos niveles (modo "fork")
+ * y páginas de demanda cero con un marco cero compartido (modo "zero-page"). Un hilo de
+ * fusión detecta páginas residentes con el mismo contenido y las comparte (modo "ksm").
+ * La memoria física se respalda con mmap, así que las trazas de cargas y almacenamientos se
+ * aplican sobre datos reales (modo "replay"). En Linux, una región real registrada con
+ * userfaultfd recibe sus páginas del simulador para medir fallos reales (modo "uffd").
+ * Las páginas contiguas en memoria física se traducen con una tabla de rangos que evita
+ * recorrer la tabla de páginas tras un fallo del TLB (modo "ranges").
+ *
+ * Compilación: gcc -O2 -pthread Pag_Virtual.c -o pag_virtual
+ * Uso: ./pag_virtual                      (modo interactivo)
+ *      ./pag_virtual swap-bench [hilos]   (rendimiento del asignador de swap)
+ *      ./pag_virtual zswap [accesos]      (swap directo frente a caché comprimida)
+ *      ./pag_virtual tiers [accesos]      (memoria en dos niveles con migración)
+ *      ./pag_virtual ws [accesos]         (políticas WS(τ) y PFF, conjunto de trabajo)
+ *      ./pag_virtual thrashing [procesos] (control de admisión frente a hiperpaginación)
+ *      ./pag_virtual kswapd [accesos]     (reclamación en segundo plano frente a directa)
+ *      ./pag_virtual fork [páginas]       (fork con copia completa y con copia en escritura)
+ *      ./pag_virtual zero-page [accesos]  (marco cero compartido para lecturas de páginas nuevas)
+ *      ./pag_virtual ksm [accesos]        (fusión de páginas idénticas entre máquinas virtuales)
+ *      ./pag_virtual replay [registros | fichero] (traza de cargas y almacenamientos con datos;
+ *                                         un fichero de nombre numérico se indica como ./nombre)
+ *      ./pag_virtual uffd [hilos]         (fallos reales con userfaultfd servidos por el simulador)
+ *      ./pag_virtual ranges [accesos]     (traducción por rangos de marcos contiguos)
  */
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #define PAGE_SIZE (1 << 12)  // Tamaño de página: 4KB (2^12 bytes)
 #define VIRTUAL_ADDRESS_BITS 32 // Tamaño de dirección virtual: 32 bits
 #define PHYSICAL_ADDRESS_BITS 21 // Tamaño de memoria física: 2^21 bytes
 
+#define SWAP_SLOTS (1 << 16)      // Bloques de swap disponibles (256 MB con páginas de 4KB)
+#define SWAP_CLUSTER_SLOTS 64     // Bloques por cluster: una palabra de 64 bits del bitmap
+#define SWAP_CLUSTERS (SWAP_SLOTS / SWAP_CLUSTER_SLOTS)
+#define MAX_CPUS 64               // Número máximo de CPUs (hilos) con cluster propio
+
+#define NUM_FRAMES (1 << (PHYSICAL_ADDRESS_BITS - 12)) // Marcos de memoria física: 512
+#define NO_SWAP_SLOT -1           // page_frame de una página ausente que nunca se ha escrito a swap
+#define MEMORY_ACCESS_TIME 70     // Tiempo de acceso a la memoria principal en ns
+#define PAGE_FAULT_TIME 1000      // Coste de atender un fallo de página (trap + manejador) en ns
+#define SWAP_ACCESS_TIME 100000   // Tiempo de lectura de una página del dispositivo de swap en ns
+
+#define FAR_MEMORY_ACCESS_TIME 250 // Tiempo de acceso al nivel lejano (memoria CXL) en ns
+#define MIGRATION_INTERVAL 10000  // Accesos entre dos muestreos del migrador de niveles
+#define MIGRATION_BATCH 16        // Máximo de intercambios DRAM <-> lejana por muestreo
+#define HOT_PAGE_HEAT 0xC0        // Temperatura mínima para promover una página a DRAM
+
+#define WATERMARK_MIN 4           // Marcos libres por debajo de los cuales el fallo reclama directamente
+#define WATERMARK_LOW 16          // Marcos libres por debajo de los cuales se despierta al reclamador
+#define WATERMARK_HIGH 32         // Marcos libres hasta los que reclama el reclamador
+#define FAULT_LATENCY_BUCKETS 32  // Cubetas log2(ns) del histograma de latencia de fallos
+#define RECLAIM_BATCH 8           // Páginas que desaloja el reclamador antes de ceder el cerrojo
+#define RECLAIM_PAUSE_NS 50000    // Pausa del reclamador entre lotes si nadie lo despierta antes
+
+#define ZSWAP_MAX_POOL_PERCENT 20             // Fracción de la RAM reservada a la caché comprimida
+#define ZSWAP_MAX_STORED_SIZE (PAGE_SIZE * 3 / 4) // Páginas que no bajan de este tamaño van a swap
+#define ZSWAP_COMPRESS_TIME 5000              // Coste modelado de comprimir una página en ns (LZO en una CPU actual)
+#define ZSWAP_DECOMPRESS_TIME 2000            // Coste modelado de descomprimir una página en ns
+
 // Estructura que representa una entrada de la tabla de páginas
 typedef struct {
     int presence_bit;     // Bit de presencia: indica si la página está en memoria física (1) o en swap (0)
     int modified_bit;     // Bit de modificado: indica si la página ha sido modificada
     int page_frame;       // Marco de página o bloque de swap
+    int referenced_bit;   // Bit de referencia: lo activa cada acceso y lo limpia el algoritmo de reemplazo
+    int cow_bit;          // Bit de copia en escritura: página compartida de sólo lectura
 } PageTableEntry;
 
 // Tabla de páginas de ejemplo, tal como se proporciona en el enunciado
 PageTableEntry page_table[] = {
-    {1, 1, 0},
-    {0, 0, 8},
-    {1, 0, 9},
-    {1, 1, 14},
-    {1, 0, 3},
-    {1, 0, 7},
-    {0, 1, 25},
-    {0, 1, 16}
+    {.presence_bit = 1, .modified_bit = 1, .page_frame = 0},
+    {.presence_bit = 0, .modified_bit = 0, .page_frame = 8},
+    {.presence_bit = 1, .modified_bit = 0, .page_frame = 9},
+    {.presence_bit = 1, .modified_bit = 1, .page_frame = 14},
+    {.presence_bit = 1, .modified_bit = 0, .page_frame = 3},
+    {.presence_bit = 1, .modified_bit = 0, .page_frame = 7},
+    {.presence_bit = 0, .modified_bit = 1, .page_frame = 25},
+    {.presence_bit = 0, .modified_bit = 1, .page_frame = 16}
 };
 
 /**
@@ -69,14 +142,3442 @@ int get_physical_address(uint32_t virtual_address) {
     return physical_address;
 }
 
+/* ------------------------------------------------------------------------
+ * Asignador de bloques de swap
+ * ------------------------------------------------------------------------
+ * El campo page_frame de una página ausente guarda su bloque de swap. Los
+ * bloques se reparten en clusters de 64: cada CPU toma un cluster completo y
+ * asigna dentro de él sin bloqueos, de modo que las escrituras de una misma CPU
+ * quedan contiguas en el dispositivo. El bitmap de bloques ocupados se recorre
+ * con ctz (primer bloque libre) y popcount (ocupación de un cluster).
+ */
+
+// Estado del espacio de swap
+typedef struct {
+    _Atomic uint64_t bitmap[SWAP_CLUSTERS]; // Un bit por bloque: 1 = ocupado
+    int cluster_owned[SWAP_CLUSTERS];       // 1 si el cluster es el actual de alguna CPU
+    int free_clusters[SWAP_CLUSTERS];       // Pila de clusters completamente libres
+    int num_free_clusters;                  // Elementos en la pila de clusters libres
+    int cpu_cluster[MAX_CPUS];              // Cluster actual de cada CPU (-1 si ninguno)
+    pthread_mutex_t lock;                   // Protege la pila y la propiedad de clusters
+} SwapSpace;
+
 /**
- * Función: main
- * Descripción: Ejecuta la simulación solicitando al usuario una dirección virtual y calculando
- *              su dirección física si es posible. También calcula el tamaño del espacio de
- *              direcciones virtuales.
+ * Función: swap_init
+ * Descripción: Inicializa el espacio de swap con todos los bloques libres.
+ * Parámetros:
+ *   - swap: espacio de swap a inicializar.
  */
-int main() {
-    uint32_t virtual_address;
+void swap_init(SwapSpace *swap) {
+    for (int c = 0; c < SWAP_CLUSTERS; c++) {
+        atomic_init(&swap->bitmap[c], 0);
+        swap->cluster_owned[c] = 0;
+        // Se apilan en orden inverso para entregar primero los clusters bajos
+        swap->free_clusters[c] = SWAP_CLUSTERS - 1 - c;
+    }
+    swap->num_free_clusters = SWAP_CLUSTERS;
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        swap->cpu_cluster[cpu] = -1;
+    }
+    pthread_mutex_init(&swap->lock, NULL);
+}
+
+/**
+ * Función: swap_take_cluster
+ * Descripción: Entrega a una CPU un nuevo cluster. Se prefiere un cluster
+ *              completamente libre; si no queda ninguno se reconstruye la pila
+ *              buscando clusters vacíos (popcount 0) y, como último recurso, se
+ *              entrega el cluster parcialmente ocupado con más bloques libres.
+ *              Debe llamarse con swap->lock tomado.
+ * Retorno:
+ *   - Índice del cluster, o -1 si el swap está lleno.
+ */
+static int swap_take_cluster(SwapSpace *swap) {
+    if (swap->num_free_clusters == 0) {
+        int best = -1, best_used = SWAP_CLUSTER_SLOTS;
+        for (int c = SWAP_CLUSTERS - 1; c >= 0; c--) {
+            if (swap->cluster_owned[c]) continue;
+            int used = __builtin_popcountll(atomic_load(&swap->bitmap[c]));
+            if (used == 0) {
+                swap->free_clusters[swap->num_free_clusters++] = c;
+            } else if (used < best_used) {
+                best = c;
+                best_used = used;
+            }
+        }
+        if (swap->num_free_clusters == 0) {
+            if (best != -1) swap->cluster_owned[best] = 1;
+            return best;
+        }
+    }
+    int cluster = swap->free_clusters[--swap->num_free_clusters];
+    swap->cluster_owned[cluster] = 1;
+    return cluster;
+}
+
+/**
+ * Función: swap_slot_alloc
+ * Descripción: Asigna un bloque de swap desde el cluster actual de la CPU. Sólo
+ *              la CPU propietaria asigna en su cluster, por lo que el camino
+ *              rápido no necesita bloqueos; el mutex se toma únicamente al
+ *              agotarse el cluster.
+ * Parámetros:
+ *   - swap: espacio de swap.
+ *   - cpu: CPU que solicita el bloque (0 .. MAX_CPUS - 1).
+ * Retorno:
+ *   - Número de bloque asignado, o -1 si no quedan bloques libres.
+ */
+int swap_slot_alloc(SwapSpace *swap, int cpu) {
+    int cluster = swap->cpu_cluster[cpu];
+    for (;;) {
+        if (cluster != -1) {
+            uint64_t used = atomic_load_explicit(&swap->bitmap[cluster], memory_order_relaxed);
+            if (~used != 0) {
+                int bit = __builtin_ctzll(~used);
+                atomic_fetch_or_explicit(&swap->bitmap[cluster], (uint64_t)1 << bit, memory_order_relaxed);
+                return cluster * SWAP_CLUSTER_SLOTS + bit;
+            }
+        }
+
+        // Cluster agotado (o inexistente): se cambia por otro bajo el mutex
+        pthread_mutex_lock(&swap->lock);
+        if (cluster != -1) swap->cluster_owned[cluster] = 0;
+        cluster = swap_take_cluster(swap);
+        swap->cpu_cluster[cpu] = cluster;
+        pthread_mutex_unlock(&swap->lock);
+        if (cluster == -1) return -1;
+    }
+}
+
+/**
+ * Función: swap_slot_free
+ * Descripción: Libera un bloque de swap. Puede llamarse desde cualquier CPU.
+ * Parámetros:
+ *   - swap: espacio de swap.
+ *   - slot: número de bloque a liberar.
+ */
+void swap_slot_free(SwapSpace *swap, int slot) {
+    uint64_t mask = (uint64_t)1 << (slot % SWAP_CLUSTER_SLOTS);
+    atomic_fetch_and_explicit(&swap->bitmap[slot / SWAP_CLUSTER_SLOTS], ~mask, memory_order_relaxed);
+}
+
+/**
+ * Función: swap_slots_in_use
+ * Descripción: Cuenta los bloques de swap ocupados con popcount sobre el bitmap.
+ * Retorno:
+ *   - Número de bloques ocupados.
+ */
+int swap_slots_in_use(SwapSpace *swap) {
+    int total = 0;
+    for (int c = 0; c < SWAP_CLUSTERS; c++) {
+        total += __builtin_popcountll(atomic_load(&swap->bitmap[c]));
+    }
+    return total;
+}
+
+/**
+ * Función: swap_slot_alloc_global
+ * Descripción: Asignador de referencia sin clusters: un único mutex y búsqueda
+ *              del primer bloque libre en todo el bitmap. Se usa sólo para
+ *              comparar en el benchmark.
+ * Retorno:
+ *   - Número de bloque asignado, o -1 si no quedan bloques libres.
+ */
+int swap_slot_alloc_global(SwapSpace *swap) {
+    pthread_mutex_lock(&swap->lock);
+    for (int c = 0; c < SWAP_CLUSTERS; c++) {
+        uint64_t used = atomic_load_explicit(&swap->bitmap[c], memory_order_relaxed);
+        if (~used != 0) {
+            int bit = __builtin_ctzll(~used);
+            atomic_fetch_or_explicit(&swap->bitmap[c], (uint64_t)1 << bit, memory_order_relaxed);
+            pthread_mutex_unlock(&swap->lock);
+            return c * SWAP_CLUSTER_SLOTS + bit;
+        }
+    }
+    pthread_mutex_unlock(&swap->lock);
+    return -1;
+}
+
+/**
+ * Función: swap_out_page
+ * Descripción: Envía una página a swap: le asigna un bloque, la marca como
+ *              ausente y guarda el bloque en page_frame.
+ * Parámetros:
+ *   - swap: espacio de swap.
+ *   - entry: entrada de la tabla de páginas a desalojar.
+ *   - cpu: CPU que realiza el desalojo.
+ * Retorno:
+ *   - Bloque de swap asignado, o -1 si el swap está lleno.
+ */
+int swap_out_page(SwapSpace *swap, PageTableEntry *entry, int cpu) {
+    int slot = swap_slot_alloc(swap, cpu);
+    if (slot == -1) return -1;
+    entry->presence_bit = 0;
+    entry->page_frame = slot;
+    return slot;
+}
+
+/**
+ * Función: now_seconds
+ * Descripción: Devuelve el tiempo de un reloj monótono en segundos.
+ */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+#define SWAP_BENCH_BATCH 256        // Bloques asignados por cada hilo antes de liberarlos
+#define SWAP_BENCH_ROUNDS 4000      // Rondas de asignación/liberación por hilo
+
+// Parámetros y resultados de un hilo escritor del benchmark
+typedef struct {
+    SwapSpace *swap;
+    int cpu;
+    int use_clusters;     // 1 = asignador por clusters, 0 = asignador global
+    long allocations;     // Bloques asignados
+    long sequential;      // Asignaciones contiguas a la anterior del mismo hilo
+} SwapBenchThread;
+
+static void *swap_bench_worker(void *arg) {
+    SwapBenchThread *t = arg;
+    int slots[SWAP_BENCH_BATCH];
+
+    for (int round = 0; round < SWAP_BENCH_ROUNDS; round++) {
+        int count = 0;
+        for (int i = 0; i < SWAP_BENCH_BATCH; i++) {
+            int slot = t->use_clusters ? swap_slot_alloc(t->swap, t->cpu)
+                                       : swap_slot_alloc_global(t->swap);
+            if (slot == -1) break;
+            if (count > 0 && slot == slots[count - 1] + 1) t->sequential++;
+            slots[count++] = slot;
+        }
+        t->allocations += count;
+        for (int i = 0; i < count; i++) {
+            swap_slot_free(t->swap, slots[i]);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Función: run_swap_benchmark
+ * Descripción: Mide el rendimiento de asignación de bloques de swap con varios
+ *              hilos escritores, comparando el asignador por clusters con el
+ *              asignador global. También informa qué fracción de asignaciones
+ *              consecutivas de un mismo hilo resultan en bloques contiguos.
+ * Parámetros:
+ *   - num_threads: número de hilos escritores (1 .. MAX_CPUS).
+ */
+void run_swap_benchmark(int num_threads) {
+    const char *names[] = {"global (un mutex)", "clusters por CPU"};
+    pthread_t threads[MAX_CPUS];
+    SwapBenchThread args[MAX_CPUS];
+
+    printf("Benchmark del asignador de swap: %d hilos, %d bloques de swap\n", num_threads, SWAP_SLOTS);
+    for (int use_clusters = 0; use_clusters <= 1; use_clusters++) {
+        SwapSpace *swap = malloc(sizeof(SwapSpace));
+        swap_init(swap);
+
+        double start = now_seconds();
+        for (int i = 0; i < num_threads; i++) {
+            args[i] = (SwapBenchThread){swap, i, use_clusters, 0, 0};
+            pthread_create(&threads[i], NULL, swap_bench_worker, &args[i]);
+        }
+        long allocations = 0, sequential = 0;
+        for (int i = 0; i < num_threads; i++) {
+            pthread_join(threads[i], NULL);
+            allocations += args[i].allocations;
+            sequential += args[i].sequential;
+        }
+        double elapsed = now_seconds() - start;
+
+        printf(" - Asignador %s: %.2f M asignaciones/s, %.1f%% contiguas, %d bloques ocupados al final\n",
+               names[use_clusters], allocations / elapsed / 1e6,
+               allocations ? 100.0 * sequential / allocations : 0.0, swap_slots_in_use(swap));
+        pthread_mutex_destroy(&swap->lock);
+        free(swap);
+    }
+}
+
+/* ------------------------------------------------------------------------
+ * Compresor LZ (formato de bloques estilo LZ4)
+ * ------------------------------------------------------------------------
+ * Cada secuencia es: token (4 bits de longitud de literales, 4 bits de
+ * longitud de coincidencia - 4), bytes de extensión de longitud, literales,
+ * desplazamiento de 2 bytes y extensión de la coincidencia. La última
+ * secuencia sólo lleva literales. Las coincidencias se buscan con una tabla
+ * hash de secuencias de 4 bytes.
+ */
+
+#define LZ_HASH_BITS 12   // Entradas de la tabla hash del compresor: 4096
+#define LZ_MIN_MATCH 4    // Longitud mínima de una coincidencia
+
+static uint32_t lz_read32(const uint8_t *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static int lz_hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// Escribe los bytes de extensión de una longitud que no cabe en su nibble
+static uint8_t *lz_write_length(uint8_t *op, int remainder) {
+    while (remainder >= 255) {
+        *op++ = 255;
+        remainder -= 255;
+    }
+    *op++ = (uint8_t)remainder;
+    return op;
+}
+
+/**
+ * Función: lz_emit_sequence
+ * Descripción: Escribe una secuencia (literales + coincidencia opcional).
+ * Retorno:
+ *   - Puntero tras la secuencia escrita, o NULL si no cabe en el destino.
+ */
+static uint8_t *lz_emit_sequence(uint8_t *op, uint8_t *oend, const uint8_t *literals,
+                                 int literal_len, int offset, int match_len) {
+    int match_code = match_len ? match_len - LZ_MIN_MATCH : 0;
+    // Tamaño en el peor caso de la secuencia
+    if (oend - op < 1 + literal_len / 255 + 1 + literal_len + 2 + match_code / 255 + 1) return NULL;
+
+    uint8_t *token = op++;
+    *token = (uint8_t)((literal_len >= 15 ? 15 : literal_len) << 4);
+    if (literal_len >= 15) op = lz_write_length(op, literal_len - 15);
+    memcpy(op, literals, literal_len);
+    op += literal_len;
+
+    if (match_len) {
+        *op++ = (uint8_t)(offset & 0xFF);
+        *op++ = (uint8_t)(offset >> 8);
+        *token |= (uint8_t)(match_code >= 15 ? 15 : match_code);
+        if (match_code >= 15) op = lz_write_length(op, match_code - 15);
+    }
+    return op;
+}
+
+/**
+ * Función: lz_compress
+ * Descripción: Comprime un bloque de menos de 64 KB.
+ * Parámetros:
+ *   - src, src_len: datos a comprimir.
+ *   - dst, dst_capacity: búfer de salida.
+ * Retorno:
+ *   - Tamaño comprimido, o -1 si no cabe en dst_capacity.
+ */
+int lz_compress(const uint8_t *src, int src_len, uint8_t *dst, int dst_capacity) {
+    uint16_t table[1 << LZ_HASH_BITS]; // Última posición + 1 de cada hash (0 = vacía)
+    uint8_t *op = dst, *oend = dst + dst_capacity;
+    int pos = 0, anchor = 0;
+
+    if (src_len > 0xFFFF) return -1;
+    memset(table, 0, sizeof(table));
+    while (pos + LZ_MIN_MATCH <= src_len) {
+        uint32_t sequence = lz_read32(src + pos);
+        int h = lz_hash(sequence);
+        int ref = table[h] - 1;
+        table[h] = (uint16_t)(pos + 1);
+        if (ref < 0 || lz_read32(src + ref) != sequence) {
+            // Sin coincidencia: el paso crece con los literales acumulados (datos incompresibles)
+            pos += 1 + ((pos - anchor) >> 6);
+            continue;
+        }
+
+        // Extensión de la coincidencia de 8 en 8 bytes: el primer byte distinto lo da ctz del XOR
+        int len = LZ_MIN_MATCH;
+        while (pos + len + 8 <= src_len) {
+            uint64_t a, b;
+            memcpy(&a, src + ref + len, 8);
+            memcpy(&b, src + pos + len, 8);
+            if (a != b) {
+                len += __builtin_ctzll(a ^ b) / 8;
+                break;
+            }
+            len += 8;
+        }
+        if (pos + len + 8 > src_len) {
+            while (pos + len < src_len && src[ref + len] == src[pos + len]) len++;
+        }
+        op = lz_emit_sequence(op, oend, src + anchor, pos - anchor, pos - ref, len);
+        if (op == NULL) return -1;
+        pos += len;
+        anchor = pos;
+    }
+
+    op = lz_emit_sequence(op, oend, src + anchor, src_len - anchor, 0, 0);
+    return op ? (int)(op - dst) : -1;
+}
+
+/**
+ * Función: lz_decompress
+ * Descripción: Descomprime un bloque producido por lz_compress, validando
+ *              todos los límites de entrada y salida.
+ * Retorno:
+ *   - Tamaño descomprimido, o -1 si los datos están corruptos.
+ */
+int lz_decompress(const uint8_t *src, int src_len, uint8_t *dst, int dst_capacity) {
+    const uint8_t *ip = src, *iend = src + src_len;
+    uint8_t *op = dst, *oend = dst + dst_capacity;
+
+    while (ip < iend) {
+        int token = *ip++;
+        int literal_len = token >> 4;
+        if (literal_len == 15) {
+            int b;
+            do {
+                if (ip >= iend) return -1;
+                b = *ip++;
+                literal_len += b;
+            } while (b == 255);
+        }
+        if (literal_len > iend - ip || literal_len > oend - op) return -1;
+        if (literal_len <= 16 && iend - ip >= 16 && oend - op >= 16) {
+            memcpy(op, ip, 16); // Copia de tamaño fijo: evita la llamada a memcpy en secuencias cortas
+        } else {
+            memcpy(op, ip, literal_len);
+        }
+        op += literal_len;
+        ip += literal_len;
+        if (ip == iend) break; // Última secuencia: sólo literales
+
+        if (iend - ip < 2) return -1;
+        int offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        int match_len = token & 15;
+        if (match_len == 15) {
+            int b;
+            do {
+                if (ip >= iend) return -1;
+                b = *ip++;
+                match_len += b;
+            } while (b == 255);
+        }
+        match_len += LZ_MIN_MATCH;
+        if (offset == 0 || offset > op - dst || match_len > oend - op) return -1;
+
+        const uint8_t *match = op - offset;
+        if (offset >= 16 && match_len <= 16 && oend - op >= 16) {
+            memcpy(op, match, 16);
+            op += match_len;
+        } else {
+            // Coincidencia posiblemente solapada: el tramo ya copiado es periódico, así que
+            // cada copia puede duplicar su tamaño sin que origen y destino se solapen
+            while (match_len > 0) {
+                int chunk = (int)(op - match) < match_len ? (int)(op - match) : match_len;
+                memcpy(op, match, chunk);
+                op += chunk;
+                match_len -= chunk;
+            }
+        }
+    }
+    return (int)(op - dst);
+}
+
+/* ------------------------------------------------------------------------
+ * Simulador de paginación por demanda
+ * ------------------------------------------------------------------------
+ * Los NUM_FRAMES marcos de la memoria física se reparten entre las páginas de
+ * los procesos simulados. Un fallo toma un marco libre o desaloja uno con el
+ * algoritmo del reloj; la página desalojada recibe un bloque de swap y su
+ * contenido va a la caché comprimida (si está activa) o al fichero de swap.
+ */
+
+// Espacio de direcciones de un proceso simulado
+typedef struct {
+    int pid;
+    PageTableEntry *table;  // Tabla de páginas lineal
+    int num_pages;
+    int resident_pages;     // Páginas presentes en memoria física
+    long virtual_time;      // Referencias realizadas por el proceso (tiempo virtual)
+    long last_fault_time;   // Tiempo virtual del último fallo (PFF)
+    int image_pages;        // Páginas iniciales con el contenido de una imagen común a todos los procesos
+    int ws_size;            // Tamaño del conjunto de trabajo W(t, τ)
+    int *ws_window;         // Últimas τ páginas referenciadas (buffer circular)
+    int *ws_count;          // Referencias de cada página dentro de la ventana
+} Process;
+
+// Políticas del motor de reemplazo
+typedef enum {
+    POLICY_CLOCK,        // Reloj global (segunda oportunidad)
+    POLICY_WORKING_SET,  // Conjunto de trabajo de Denning: se libera la página que sale de la ventana τ
+    POLICY_PFF           // Frecuencia de fallos: si el intervalo entre fallos supera τ se recorta el conjunto residente
+} ReplacementPolicy;
+
+// Información de cada marco físico (mapa inverso marco -> página)
+typedef struct {
+    Process *owner;         // Proceso propietario, NULL si el marco está libre o reservado
+    int page_number;        // Página virtual alojada en el marco
+    uint8_t heat;           // Historial de bits de referencia muestreados (el bit 7 es el más reciente)
+    int ksm;                // 1 si es un marco compartido por fusión de páginas (sin propietario)
+    int sharers;            // Entradas de tabla de páginas que apuntan a un marco compartido
+    uint32_t checksum;      // Hash del contenido en el último escaneo de fusión
+} FrameInfo;
+
+// Caché comprimida indexada por bloque de swap, con lista LRU para la escritura a swap
+typedef struct {
+    uint8_t *data[SWAP_SLOTS];   // Página comprimida de cada bloque (NULL si no está en la caché)
+    uint16_t size[SWAP_SLOTS];   // Tamaño comprimido
+    int lru_prev[SWAP_SLOTS];    // Lista doblemente enlazada: de la más antigua a la más reciente
+    int lru_next[SWAP_SLOTS];
+    int lru_head, lru_tail;
+    long pool_bytes;             // Bytes comprimidos almacenados
+    long max_pool_bytes;         // Capacidad de la caché
+} ZswapPool;
+
+// Estadísticas de una simulación
+typedef struct {
+    long accesses;          // Accesos a memoria
+    long faults;            // Fallos de página (de cualquier tipo)
+    long first_touch;       // Fallos de páginas que nunca habían estado en swap
+    long major_faults;      // Fallos servidos desde el dispositivo de swap
+    long zswap_loads;       // Fallos servidos desde la caché comprimida
+    long evictions;         // Páginas desalojadas
+    long swap_writes;       // Páginas escritas en el fichero de swap
+    long zswap_stores;      // Páginas guardadas en la caché comprimida
+    long zswap_rejects;     // Páginas que no comprimían lo suficiente
+    long zswap_writebacks;  // Páginas expulsadas de la caché comprimida al swap
+    long stored_bytes;      // Suma de tamaños originales guardados en la caché
+    long compressed_bytes;  // Suma de tamaños comprimidos guardados en la caché
+    double access_time_ns;  // Tiempo total modelado de los accesos
+    double compress_ns;     // Tiempo de CPU medido en compresión (no entra en access_time_ns)
+    double decompress_ns;   // Tiempo de CPU medido en descompresión (no entra en access_time_ns)
+    long dram_accesses;     // Accesos servidos desde el nivel DRAM (modo de dos niveles)
+    long migrations;        // Páginas movidas entre niveles
+    long direct_reclaims;   // Fallos que tuvieron que desalojar una página ellos mismos
+    long background_reclaims; // Páginas desalojadas por el hilo reclamador
+    long fault_latency_hist[FAULT_LATENCY_BUCKETS]; // Latencia medida de los fallos: cubeta i = [2^i, 2^(i+1)) ns
+    long zero_page_maps;    // Lecturas de páginas nuevas resueltas con el marco cero
+    long zero_page_breaks;  // Primeras escrituras que sustituyen el marco cero por uno propio
+    long ksm_cow_breaks;    // Escrituras que sacan una página de un marco compartido por fusión
+} PagingStats;
+
+// Estado completo del simulador
+typedef struct {
+    uint8_t *memory;                // Contenido de la memoria física (NUM_FRAMES * PAGE_SIZE, proyectada con mmap)
+    FrameInfo frames[NUM_FRAMES];
+    int free_frames[NUM_FRAMES];    // Pila de marcos libres
+    int num_free;
+    int clock_hand;                 // Posición de la manecilla del reloj
+    SwapSpace swap;                 // Bloques de swap
+    int swap_fd;                    // Fichero de swap
+    ZswapPool *zswap;               // Caché comprimida, NULL si está desactivada
+    int dram_frames;                // Marcos [0, dram_frames) en DRAM y el resto lejanos; 0 = un solo nivel
+    int migration_enabled;          // 1 si el migrador de niveles está activo
+    ReplacementPolicy policy;       // Política de reemplazo
+    long tau;                       // Ventana τ de WS y umbral entre fallos de PFF (0 = sin seguimiento)
+    int watermark_min;              // Marca mínima: por debajo, reclamación directa en el fallo
+    int watermark_low;              // Marca baja: por debajo, se despierta al reclamador
+    int watermark_high;             // Marca alta: el reclamador se detiene al alcanzarla
+    int reclaimer_running;          // 1 mientras existe el hilo reclamador
+    int background_threads;         // Hilos en segundo plano activos: si hay alguno, paging_access toma el cerrojo
+    int reclaimer_stop;             // Petición de parada al reclamador
+    pthread_t reclaimer;
+    pthread_mutex_t lock;           // Protege todo el simulador cuando hay hilo reclamador
+    pthread_cond_t reclaim_wakeup;  // Despierta al reclamador
+    int zero_frame;                 // Marco cero compartido, -1 si no se usa
+    PagingStats stats;
+} PagingSystem;
+
+static uint64_t rng_next(uint64_t *state) {
+    // xorshift64*
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+static double rng_uniform(uint64_t *state) {
+    return (rng_next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static uint8_t *frame_data(PagingSystem *sys, int frame) {
+    return sys->memory + (size_t)frame * PAGE_SIZE;
+}
+
+/**
+ * Función: fill_page_contents
+ * Descripción: Genera el contenido inicial de una página de forma determinista
+ *              a partir del proceso y del número de página. La mezcla imita la
+ *              de un proceso real: páginas a cero, registros repetitivos, texto
+ *              y datos incompresibles.
+ */
+void fill_page_contents(uint8_t *page, int pid, int page_number) {
+    static const char *words[] = {"memoria", "pagina", "marco", "swap", "proceso", "tabla",
+                                  "direccion", "fallo", "reloj", "bloque", "virtual", "fisica"};
+    uint64_t seed = (((uint64_t)pid << 32) | (uint32_t)page_number) * 0x9E3779B97F4A7C15ULL + 1;
+    int kind = rng_next(&seed) % 20;
+
+    if (kind < 6) {
+        memset(page, 0, PAGE_SIZE);
+    } else if (kind < 12) {
+        // Registros de 64 bytes con una plantilla común y algunos campos variables
+        for (int i = 0; i < PAGE_SIZE; i += 64) {
+            for (int j = 0; j < 64; j++) page[i + j] = (uint8_t)(j * 3);
+            uint64_t id = rng_next(&seed) & 0xFFFF;
+            memcpy(page + i, &id, sizeof(id));
+        }
+    } else if (kind < 17) {
+        int pos = 0;
+        while (pos < PAGE_SIZE) {
+            const char *word = words[rng_next(&seed) % 12];
+            for (int j = 0; word[j] && pos < PAGE_SIZE; j++) page[pos++] = word[j];
+            if (pos < PAGE_SIZE) page[pos++] = ' ';
+        }
+    } else {
+        for (int i = 0; i < PAGE_SIZE; i += 8) {
+            uint64_t value = rng_next(&seed);
+            memcpy(page + i, &value, sizeof(value));
+        }
+    }
+}
+
+/**
+ * Función: process_create
+ * Descripción: Crea un proceso con todas sus páginas ausentes y sin bloque de swap.
+ */
+Process *process_create(int pid, int num_pages) {
+    Process *proc = malloc(sizeof(Process));
+    proc->pid = pid;
+    proc->num_pages = num_pages;
+    proc->table = calloc(num_pages, sizeof(PageTableEntry));
+    for (int i = 0; i < num_pages; i++) {
+        proc->table[i].page_frame = NO_SWAP_SLOT;
+    }
+    proc->resident_pages = 0;
+    proc->virtual_time = 0;
+    proc->last_fault_time = 0;
+    proc->image_pages = 0;
+    proc->ws_size = 0;
+    proc->ws_window = NULL; // Se reserva en el primer acceso si el simulador sigue el conjunto de trabajo
+    proc->ws_count = NULL;
+    return proc;
+}
+
+void process_destroy(Process *proc) {
+    free(proc->ws_window);
+    free(proc->ws_count);
+    free(proc->table);
+    free(proc);
+}
+
+/**
+ * Función: map_physical_memory
+ * Descripción: Reserva con mmap el búfer que respalda la memoria física, con
+ *              las páginas ya presentes (MAP_POPULATE) para que las mediciones
+ *              no incluyan los fallos de página del anfitrión.
+ */
+uint8_t *map_physical_memory(size_t size) {
+    uint8_t *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (memory == MAP_FAILED) {
+        perror("mmap memoria física");
+        exit(1);
+    }
+    return memory;
+}
+
+/**
+ * Función: paging_init
+ * Descripción: Inicializa el simulador con todos los marcos libres. Si se activa
+ *              la caché comprimida, su capacidad se descuenta de la RAM: se
+ *              reservan los marcos equivalentes para que la comparación con el
+ *              swap directo sea con la misma memoria total.
+ * Parámetros:
+ *   - sys: simulador.
+ *   - use_zswap: 1 para activar la caché comprimida.
+ */
+void paging_init(PagingSystem *sys, int use_zswap) {
+    memset(&sys->stats, 0, sizeof(sys->stats));
+    sys->memory = map_physical_memory((size_t)NUM_FRAMES * PAGE_SIZE);
+    swap_init(&sys->swap);
+
+    FILE *swap_file = tmpfile();
+    if (swap_file == NULL) {
+        perror("tmpfile");
+        exit(1);
+    }
+    sys->swap_fd = dup(fileno(swap_file));
+    fclose(swap_file);
+
+    int reserved = 0;
+    sys->zswap = NULL;
+    if (use_zswap) {
+        sys->zswap = calloc(1, sizeof(ZswapPool));
+        sys->zswap->lru_head = sys->zswap->lru_tail = -1;
+        reserved = NUM_FRAMES * ZSWAP_MAX_POOL_PERCENT / 100;
+        sys->zswap->max_pool_bytes = (long)reserved * PAGE_SIZE;
+    }
+
+    sys->dram_frames = 0;
+    sys->migration_enabled = 0;
+    sys->policy = POLICY_CLOCK;
+    sys->tau = 0;
+    sys->watermark_min = sys->watermark_low = sys->watermark_high = 0;
+    sys->reclaimer_running = 0;
+    sys->background_threads = 0;
+    sys->reclaimer_stop = 0;
+    sys->zero_frame = -1;
+    pthread_mutex_init(&sys->lock, NULL);
+    pthread_cond_init(&sys->reclaim_wakeup, NULL);
+    sys->num_free = 0;
+    for (int f = NUM_FRAMES - 1; f >= 0; f--) {
+        sys->frames[f].owner = NULL;
+        sys->frames[f].page_number = -1;
+        sys->frames[f].heat = 0;
+        sys->frames[f].ksm = 0;
+        sys->frames[f].sharers = 0;
+        sys->frames[f].checksum = 0;
+        if (f >= reserved) sys->free_frames[sys->num_free++] = f;
+    }
+    sys->clock_hand = 0;
+}
+
+void paging_destroy(PagingSystem *sys) {
+    if (sys->zswap) {
+        for (int slot = 0; slot < SWAP_SLOTS; slot++) free(sys->zswap->data[slot]);
+        free(sys->zswap);
+    }
+    close(sys->swap_fd);
+    pthread_mutex_destroy(&sys->swap.lock);
+    pthread_mutex_destroy(&sys->lock);
+    pthread_cond_destroy(&sys->reclaim_wakeup);
+    munmap(sys->memory, (size_t)NUM_FRAMES * PAGE_SIZE);
+}
+
+static void swap_write(PagingSystem *sys, int slot, const uint8_t *data) {
+    if (pwrite(sys->swap_fd, data, PAGE_SIZE, (off_t)slot * PAGE_SIZE) != PAGE_SIZE) {
+        perror("pwrite swap");
+        exit(1);
+    }
+    sys->stats.swap_writes++;
+}
+
+static void swap_read(PagingSystem *sys, int slot, uint8_t *data) {
+    if (pread(sys->swap_fd, data, PAGE_SIZE, (off_t)slot * PAGE_SIZE) != PAGE_SIZE) {
+        perror("pread swap");
+        exit(1);
+    }
+}
+
+static void zswap_lru_remove(ZswapPool *pool, int slot) {
+    int prev = pool->lru_prev[slot], next = pool->lru_next[slot];
+    if (prev != -1) pool->lru_next[prev] = next; else pool->lru_head = next;
+    if (next != -1) pool->lru_prev[next] = prev; else pool->lru_tail = prev;
+}
+
+static void zswap_drop(ZswapPool *pool, int slot) {
+    zswap_lru_remove(pool, slot);
+    pool->pool_bytes -= pool->size[slot];
+    free(pool->data[slot]);
+    pool->data[slot] = NULL;
+}
+
+/**
+ * Función: zswap_writeback_oldest
+ * Descripción: Expulsa la página comprimida más antigua de la caché: la
+ *              descomprime y la escribe en su bloque del fichero de swap.
+ */
+static void zswap_writeback_oldest(PagingSystem *sys) {
+    ZswapPool *pool = sys->zswap;
+    int slot = pool->lru_head;
+    uint8_t page[PAGE_SIZE];
+
+    double start = now_seconds();
+    lz_decompress(pool->data[slot], pool->size[slot], page, PAGE_SIZE);
+    sys->stats.decompress_ns += (now_seconds() - start) * 1e9;
+    swap_write(sys, slot, page);
+    zswap_drop(pool, slot);
+    sys->stats.zswap_writebacks++;
+}
+
+/**
+ * Función: zswap_store
+ * Descripción: Intenta guardar comprimida una página desalojada.
+ * Retorno:
+ *   - 1 si la página quedó en la caché, 0 si debe escribirse en el swap.
+ */
+static int zswap_store(PagingSystem *sys, int slot, const uint8_t *data) {
+    ZswapPool *pool = sys->zswap;
+    uint8_t buffer[ZSWAP_MAX_STORED_SIZE];
+
+    double start = now_seconds();
+    int size = lz_compress(data, PAGE_SIZE, buffer, sizeof(buffer));
+    sys->stats.compress_ns += (now_seconds() - start) * 1e9;
+    if (size < 0) {
+        sys->stats.zswap_rejects++;
+        return 0;
+    }
+
+    while (pool->pool_bytes + size > pool->max_pool_bytes && pool->lru_head != -1) {
+        zswap_writeback_oldest(sys);
+    }
+
+    pool->data[slot] = malloc(size);
+    memcpy(pool->data[slot], buffer, size);
+    pool->size[slot] = (uint16_t)size;
+    pool->pool_bytes += size;
+    pool->lru_prev[slot] = pool->lru_tail;
+    pool->lru_next[slot] = -1;
+    if (pool->lru_tail != -1) pool->lru_next[pool->lru_tail] = slot; else pool->lru_head = slot;
+    pool->lru_tail = slot;
+
+    sys->stats.zswap_stores++;
+    sys->stats.stored_bytes += PAGE_SIZE;
+    sys->stats.compressed_bytes += size;
+    return 1;
+}
+
+/**
+ * Función: zswap_load
+ * Descripción: Busca en la caché comprimida el bloque de swap de una página y,
+ *              si está, lo descomprime en el marco destino y lo elimina de la caché.
+ * Retorno:
+ *   - 1 si la página se sirvió desde la caché, 0 en caso contrario.
+ */
+static int zswap_load(PagingSystem *sys, int slot, uint8_t *data) {
+    ZswapPool *pool = sys->zswap;
+    if (pool->data[slot] == NULL) return 0;
+
+    double start = now_seconds();
+    int size = lz_decompress(pool->data[slot], pool->size[slot], data, PAGE_SIZE);
+    sys->stats.decompress_ns += (now_seconds() - start) * 1e9;
+    if (size != PAGE_SIZE) {
+        fprintf(stderr, "Página comprimida corrupta en el bloque %d\n", slot);
+        exit(1);
+    }
+    sys->stats.access_time_ns += ZSWAP_DECOMPRESS_TIME;
+    zswap_drop(pool, slot);
+    return 1;
+}
+
+/**
+ * Función: clock_select_victim
+ * Descripción: Algoritmo del reloj (segunda oportunidad): avanza la manecilla
+ *              limpiando bits de referencia hasta encontrar una página no referenciada.
+ *              Dos vueltas bastan si hay algún marco con propietario; si todos son
+ *              compartidos por fusión, el marco cero o reservados, no hay nada que
+ *              desalojar y la simulación termina con un error.
+ * Retorno:
+ *   - Marco a desalojar.
+ */
+static int clock_select_victim(PagingSystem *sys) {
+    for (int step = 0; step < 2 * NUM_FRAMES; step++) {
+        int frame = sys->clock_hand;
+        sys->clock_hand = (frame + 1) % NUM_FRAMES;
+        FrameInfo *info = &sys->frames[frame];
+        if (info->owner == NULL) continue; // Marco libre o reservado
+        PageTableEntry *entry = &info->owner->table[info->page_number];
+        if (entry->referenced_bit) {
+            entry->referenced_bit = 0;
+            continue;
+        }
+        return frame;
+    }
+    fprintf(stderr, "Ningún marco se puede desalojar: todos están compartidos, reservados o son el marco cero\n");
+    exit(1);
+}
+
+/**
+ * Función: page_out
+ * Descripción: Asigna un bloque de swap a una página y guarda su contenido en la
+ *              caché comprimida o en el fichero de swap. Si el desalojo ocurre
+ *              dentro de un acceso (reclamación directa o decisión de la
+ *              política), el coste modelado de la compresión se suma al del
+ *              acceso; el del reclamador en segundo plano no.
+ * Parámetros:
+ *   - foreground: 1 si lo paga el acceso en curso, 0 si lo hace el reclamador.
+ */
+static void page_out(PagingSystem *sys, PageTableEntry *entry, const uint8_t *data, int foreground) {
+    if (swap_out_page(&sys->swap, entry, 0) == -1) {
+        fprintf(stderr, "Espacio de swap agotado\n");
+        exit(1);
+    }
+    if (sys->zswap && foreground) sys->stats.access_time_ns += ZSWAP_COMPRESS_TIME;
+    if (sys->zswap == NULL || !zswap_store(sys, entry->page_frame, data)) {
+        swap_write(sys, entry->page_frame, data);
+    }
+}
+
+/**
+ * Función: evict_frame
+ * Descripción: Desaloja la página de un marco con page_out y lo deja sin propietario.
+ */
+static void evict_frame(PagingSystem *sys, int frame, int foreground) {
+    FrameInfo *info = &sys->frames[frame];
+    PageTableEntry *entry = &info->owner->table[info->page_number];
+
+    page_out(sys, entry, frame_data(sys, frame), foreground);
+    entry->modified_bit = 0;
+    entry->referenced_bit = 0;
+    info->owner->resident_pages--;
+    info->owner = NULL;
+    info->page_number = -1;
+    sys->stats.evictions++;
+}
+
+/**
+ * Función: ksm_put_frame
+ * Descripción: Suelta una referencia a un marco compartido; el último en
+ *              soltarla lo devuelve a la pila de marcos libres.
+ */
+static void ksm_put_frame(PagingSystem *sys, int frame) {
+    FrameInfo *info = &sys->frames[frame];
+    if (--info->sharers == 0) {
+        info->ksm = 0;
+        sys->free_frames[sys->num_free++] = frame;
+    }
+}
+
+/**
+ * Función: release_page
+ * Descripción: Desaloja una página residente por decisión de la política (no por
+ *              falta de marcos) y devuelve su marco a la pila de marcos libres.
+ */
+static void release_page(PagingSystem *sys, Process *proc, int page_number) {
+    PageTableEntry *entry = &proc->table[page_number];
+    int frame = entry->page_frame;
+    if (frame == sys->zero_frame) {
+        // La página nunca se escribió: basta con deshacer la proyección del marco cero
+        entry->presence_bit = 0;
+        entry->cow_bit = 0;
+        entry->page_frame = NO_SWAP_SLOT;
+        return;
+    }
+    if (sys->frames[frame].ksm) {
+        // Página fusionada: se guarda su copia en swap y se suelta la referencia al marco compartido
+        page_out(sys, entry, frame_data(sys, frame), 1);
+        entry->cow_bit = 0;
+        entry->referenced_bit = 0;
+        entry->modified_bit = 0;
+        ksm_put_frame(sys, frame);
+        return;
+    }
+    evict_frame(sys, frame, 1);
+    sys->free_frames[sys->num_free++] = frame;
+}
+
+/* ------------------------------------------------------------------------
+ * Reclamador en segundo plano
+ * ------------------------------------------------------------------------
+ * Hilo al estilo de kswapd: duerme hasta que los marcos libres bajan de la
+ * marca baja y entonces desaloja páginas con el reloj hasta alcanzar la marca
+ * alta. Desaloja lotes de RECLAIM_BATCH páginas y entre lote y lote espera
+ * en su variable de condición (como mucho RECLAIM_PAUSE_NS) con el cerrojo
+ * suelto, de modo que los fallos se intercalan con la reclamación. Soltar el
+ * cerrojo y volver a tomarlo en seguida no basta: el mutex no es equitativo
+ * y el reclamador lo recuperaba antes que los hilos que fallan.
+ */
+
+static void *reclaimer_thread(void *arg) {
+    PagingSystem *sys = arg;
+
+    pthread_mutex_lock(&sys->lock);
+    while (!sys->reclaimer_stop) {
+        if (sys->num_free >= sys->watermark_low) {
+            pthread_cond_wait(&sys->reclaim_wakeup, &sys->lock);
+            continue;
+        }
+        while (!sys->reclaimer_stop && sys->num_free < sys->watermark_high) {
+            for (int batch = 0; batch < RECLAIM_BATCH && sys->num_free < sys->watermark_high; batch++) {
+                int frame = clock_select_victim(sys);
+                evict_frame(sys, frame, 0);
+                sys->free_frames[sys->num_free++] = frame;
+                sys->stats.background_reclaims++;
+            }
+            if (sys->num_free >= sys->watermark_high) break;
+            // Pausa con el cerrojo suelto; un fallo que necesite marcos la acorta con la señal de alloc_frame
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += RECLAIM_PAUSE_NS;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&sys->reclaim_wakeup, &sys->lock, &deadline);
+        }
+    }
+    pthread_mutex_unlock(&sys->lock);
+    return NULL;
+}
+
+/**
+ * Función: paging_start_reclaimer
+ * Descripción: Fija las marcas de agua y arranca el hilo reclamador. Desde ese
+ *              momento paging_access toma el cerrojo del simulador.
+ */
+void paging_start_reclaimer(PagingSystem *sys, int min, int low, int high) {
+    sys->watermark_min = min;
+    sys->watermark_low = low;
+    sys->watermark_high = high;
+    sys->reclaimer_stop = 0;
+    sys->reclaimer_running = 1;
+    sys->background_threads++;
+    pthread_create(&sys->reclaimer, NULL, reclaimer_thread, sys);
+}
+
+/**
+ * Función: paging_stop_reclaimer
+ * Descripción: Detiene el hilo reclamador y espera a que termine.
+ */
+void paging_stop_reclaimer(PagingSystem *sys) {
+    pthread_mutex_lock(&sys->lock);
+    sys->reclaimer_stop = 1;
+    pthread_cond_signal(&sys->reclaim_wakeup);
+    pthread_mutex_unlock(&sys->lock);
+    pthread_join(sys->reclaimer, NULL);
+    sys->reclaimer_running = 0;
+    sys->background_threads--;
+    sys->watermark_min = sys->watermark_low = sys->watermark_high = 0;
+}
+
+/**
+ * Función: paging_swap_out_process
+ * Descripción: Desaloja todas las páginas residentes de un proceso (suspensión
+ *              por el planificador a medio plazo).
+ */
+void paging_swap_out_process(PagingSystem *sys, Process *proc) {
+    for (int page = 0; page < proc->num_pages && proc->resident_pages > 0; page++) {
+        if (proc->table[page].presence_bit) release_page(sys, proc, page);
+    }
+}
+
+/**
+ * Función: paging_process_exit
+ * Descripción: Libera los marcos y bloques de swap de un proceso que termina,
+ *              sin escribir nada en swap.
+ */
+void paging_process_exit(PagingSystem *sys, Process *proc) {
+    for (int page = 0; page < proc->num_pages; page++) {
+        PageTableEntry *entry = &proc->table[page];
+        if (entry->presence_bit && entry->page_frame == sys->zero_frame) {
+            entry->cow_bit = 0;
+        } else if (entry->presence_bit && sys->frames[entry->page_frame].ksm) {
+            entry->cow_bit = 0;
+            ksm_put_frame(sys, entry->page_frame);
+        } else if (entry->presence_bit) {
+            FrameInfo *info = &sys->frames[entry->page_frame];
+            info->owner = NULL;
+            info->page_number = -1;
+            sys->free_frames[sys->num_free++] = entry->page_frame;
+        } else if (entry->page_frame != NO_SWAP_SLOT) {
+            if (sys->zswap && sys->zswap->data[entry->page_frame]) zswap_drop(sys->zswap, entry->page_frame);
+            swap_slot_free(&sys->swap, entry->page_frame);
+        }
+        entry->presence_bit = 0;
+        entry->page_frame = NO_SWAP_SLOT;
+    }
+    proc->resident_pages = 0;
+}
+
+/**
+ * Función: alloc_frame
+ * Descripción: Obtiene un marco libre. Si los marcos libres bajan de la marca baja
+ *              se despierta al reclamador; si no superan la marca mínima (sin
+ *              reclamador la marca mínima es 0) el propio fallo desaloja una
+ *              página con el reloj (reclamación directa).
+ */
+static int alloc_frame(PagingSystem *sys) {
+    if (sys->reclaimer_running && sys->num_free < sys->watermark_low) {
+        pthread_cond_signal(&sys->reclaim_wakeup);
+    }
+    if (sys->num_free > sys->watermark_min) return sys->free_frames[--sys->num_free];
+
+    sys->stats.direct_reclaims++;
+    int frame = clock_select_victim(sys);
+    evict_frame(sys, frame, 1);
+    return frame;
+}
+
+/**
+ * Función: paging_enable_zero_page
+ * Descripción: Activa la semántica de demanda cero: se reserva un marco lleno
+ *              de ceros que comparten, de sólo lectura, todas las páginas nuevas
+ *              que se leen antes de escribirse. Debe llamarse justo después de
+ *              paging_init.
+ */
+void paging_enable_zero_page(PagingSystem *sys) {
+    sys->zero_frame = sys->free_frames[--sys->num_free];
+    memset(frame_data(sys, sys->zero_frame), 0, PAGE_SIZE);
+}
+
+/**
+ * Función: handle_page_fault
+ * Descripción: Atiende un fallo de página: asigna un marco y carga el contenido
+ *              de la página. Se consulta primero la caché comprimida y, si la
+ *              página no está allí, se lee del fichero de swap. Con el marco cero
+ *              activo, la lectura de una página nueva sólo la proyecta sobre él.
+ */
+static void handle_page_fault(PagingSystem *sys, Process *proc, int page_number, int is_write) {
+    PageTableEntry *entry = &proc->table[page_number];
+    double start = now_seconds();
+    if (sys->zero_frame != -1 && entry->page_frame == NO_SWAP_SLOT && !is_write) {
+        sys->stats.faults++;
+        sys->stats.zero_page_maps++;
+        sys->stats.access_time_ns += PAGE_FAULT_TIME;
+        entry->presence_bit = 1;
+        entry->cow_bit = 1;
+        entry->page_frame = sys->zero_frame;
+        return;
+    }
+    int frame = alloc_frame(sys);
+    uint8_t *data = frame_data(sys, frame);
+
+    sys->stats.faults++;
+    sys->stats.access_time_ns += PAGE_FAULT_TIME;
+    if (entry->page_frame == NO_SWAP_SLOT) {
+        fill_page_contents(data, page_number < proc->image_pages ? 0 : proc->pid, page_number);
+        sys->stats.first_touch++;
+    } else {
+        int slot = entry->page_frame;
+        if (sys->zswap && zswap_load(sys, slot, data)) {
+            sys->stats.zswap_loads++;
+        } else {
+            swap_read(sys, slot, data);
+            sys->stats.major_faults++;
+            sys->stats.access_time_ns += SWAP_ACCESS_TIME;
+        }
+        swap_slot_free(&sys->swap, slot);
+    }
+
+    entry->presence_bit = 1;
+    entry->page_frame = frame;
+    proc->resident_pages++;
+    sys->frames[frame].owner = proc;
+    sys->frames[frame].page_number = page_number;
+    sys->frames[frame].heat = 0;
+    sys->frames[frame].sharers = 1;
+    sys->frames[frame].checksum = 0;
+
+    // Latencia real del manejador (sin la espera del dispositivo, que se modela aparte)
+    long latency_ns = (long)((now_seconds() - start) * 1e9);
+    int bucket = latency_ns > 0 ? 63 - __builtin_clzll(latency_ns) : 0;
+    sys->stats.fault_latency_hist[bucket < FAULT_LATENCY_BUCKETS ? bucket : FAULT_LATENCY_BUCKETS - 1]++;
+}
+
+/* ------------------------------------------------------------------------
+ * Memoria en dos niveles
+ * ------------------------------------------------------------------------
+ * Los marcos bajos son DRAM y el resto memoria lejana más lenta. Cada
+ * MIGRATION_INTERVAL accesos el migrador muestrea y limpia los bits de
+ * referencia, acumulándolos en la temperatura de cada marco, e intercambia
+ * las páginas lejanas más calientes con las páginas DRAM más frías. El
+ * migrador trabaja en segundo plano: su coste no se suma a los accesos, pero
+ * se contabiliza el ancho de banda que consume.
+ */
+
+/**
+ * Función: frame_access_time
+ * Descripción: Tiempo de acceso a un marco según el nivel de memoria en que está.
+ */
+static double frame_access_time(PagingSystem *sys, int frame) {
+    if (sys->dram_frames == 0) return MEMORY_ACCESS_TIME;
+    return frame < sys->dram_frames ? MEMORY_ACCESS_TIME : FAR_MEMORY_ACCESS_TIME;
+}
+
+/**
+ * Función: paging_set_tiers
+ * Descripción: Divide la memoria física en DRAM y memoria lejana. Debe llamarse
+ *              justo después de paging_init, antes del primer acceso. La pila de
+ *              marcos libres ya entrega primero los marcos bajos, así que las
+ *              páginas nuevas ocupan la DRAM mientras quede libre.
+ * Parámetros:
+ *   - sys: simulador.
+ *   - dram_frames: número de marcos DRAM (1 .. NUM_FRAMES).
+ *   - migration_enabled: 1 para activar la migración de páginas calientes y frías.
+ */
+void paging_set_tiers(PagingSystem *sys, int dram_frames, int migration_enabled) {
+    sys->dram_frames = dram_frames;
+    sys->migration_enabled = migration_enabled;
+}
+
+/**
+ * Función: exchange_frames
+ * Descripción: Intercambia el contenido y la propiedad de dos marcos, actualizando
+ *              las tablas de páginas. Uno de los dos puede ser un marco libre, en
+ *              cuyo caso ocupa su lugar en la pila de marcos libres.
+ * Retorno:
+ *   - 1 si se intercambiaron, 0 si uno de ellos es un marco reservado.
+ */
+static int exchange_frames(PagingSystem *sys, int a, int b) {
+    FrameInfo *fa = &sys->frames[a], *fb = &sys->frames[b];
+    if (fa->owner == NULL || fb->owner == NULL) {
+        int free_frame = fa->owner == NULL ? a : b, other = free_frame == a ? b : a;
+        int i = 0;
+        while (i < sys->num_free && sys->free_frames[i] != free_frame) i++;
+        if (i == sys->num_free) return 0;
+        sys->free_frames[i] = other;
+    }
+
+    uint8_t tmp[PAGE_SIZE];
+    memcpy(tmp, frame_data(sys, a), PAGE_SIZE);
+    memcpy(frame_data(sys, a), frame_data(sys, b), PAGE_SIZE);
+    memcpy(frame_data(sys, b), tmp, PAGE_SIZE);
+
+    FrameInfo info = *fa;
+    *fa = *fb;
+    *fb = info;
+    if (fa->owner) fa->owner->table[fa->page_number].page_frame = a;
+    if (fb->owner) fb->owner->table[fb->page_number].page_frame = b;
+    return 1;
+}
+
+// Marco y temperatura de un candidato a migrar
+typedef struct {
+    int frame;
+    int heat;
+} MigrationCandidate;
+
+static int compare_candidates_hot_first(const void *a, const void *b) {
+    return ((const MigrationCandidate *)b)->heat - ((const MigrationCandidate *)a)->heat;
+}
+
+static int compare_candidates_cold_first(const void *a, const void *b) {
+    return ((const MigrationCandidate *)a)->heat - ((const MigrationCandidate *)b)->heat;
+}
+
+/**
+ * Función: tier_migration_scan
+ * Descripción: Muestreo de bits de referencia y migración entre niveles. Promueve
+ *              hasta MIGRATION_BATCH páginas lejanas calientes, cada una a cambio
+ *              de la página DRAM más fría que ella (o de un marco DRAM libre).
+ */
+static void tier_migration_scan(PagingSystem *sys) {
+    MigrationCandidate hot[NUM_FRAMES], cold[NUM_FRAMES];
+    int num_hot = 0, num_cold = 0;
+
+    for (int f = 0; f < NUM_FRAMES; f++) {
+        FrameInfo *info = &sys->frames[f];
+        if (info->owner == NULL) {
+            if (f < sys->dram_frames) cold[num_cold++] = (MigrationCandidate){f, -1};
+            continue;
+        }
+        PageTableEntry *entry = &info->owner->table[info->page_number];
+        info->heat = (uint8_t)((info->heat >> 1) | (entry->referenced_bit ? 0x80 : 0));
+        entry->referenced_bit = 0;
+        if (f < sys->dram_frames) {
+            cold[num_cold++] = (MigrationCandidate){f, info->heat};
+        } else if (info->heat >= HOT_PAGE_HEAT) {
+            hot[num_hot++] = (MigrationCandidate){f, info->heat};
+        }
+    }
+    if (!sys->migration_enabled) return;
+
+    qsort(hot, num_hot, sizeof(MigrationCandidate), compare_candidates_hot_first);
+    qsort(cold, num_cold, sizeof(MigrationCandidate), compare_candidates_cold_first);
+    int moved = 0;
+    for (int i = 0, j = 0; i < num_hot && j < num_cold && moved < MIGRATION_BATCH; i++, j++) {
+        if (hot[i].heat <= cold[j].heat) break;
+        if (exchange_frames(sys, hot[i].frame, cold[j].frame)) {
+            // Un intercambio con una página fría son dos migraciones (promoción y degradación)
+            sys->stats.migrations += sys->frames[hot[i].frame].owner ? 2 : 1;
+            moved++;
+        }
+    }
+}
+
+/* ------------------------------------------------------------------------
+ * Políticas de conjunto de trabajo
+ * ------------------------------------------------------------------------
+ * El tiempo es virtual: cada proceso avanza una unidad por referencia. W(t, τ)
+ * se mantiene de forma incremental con un buffer circular de las últimas τ
+ * referencias y un contador por página, así que cada acceso cuesta O(1): la
+ * página referenciada entra en la ventana y la de hace τ referencias sale.
+ */
+
+/**
+ * Función: paging_set_policy
+ * Descripción: Selecciona la política de reemplazo. Debe llamarse justo después
+ *              de paging_init. Con tau > 0 se sigue además el tamaño del
+ *              conjunto de trabajo de cada proceso aunque la política sea el reloj.
+ * Parámetros:
+ *   - sys: simulador.
+ *   - policy: política de reemplazo.
+ *   - tau: ventana de WS o intervalo entre fallos de PFF, en referencias.
+ */
+void paging_set_policy(PagingSystem *sys, ReplacementPolicy policy, long tau) {
+    sys->policy = policy;
+    sys->tau = tau;
+}
+
+/**
+ * Función: working_set_update
+ * Descripción: Avanza la ventana del conjunto de trabajo con la página
+ *              referenciada. Con la política WS, la página que deja de estar en
+ *              la ventana se desaloja en ese mismo instante.
+ */
+static void working_set_update(PagingSystem *sys, Process *proc, int page_number) {
+    if (proc->ws_window == NULL) {
+        proc->ws_window = malloc(sys->tau * sizeof(int));
+        proc->ws_count = calloc(proc->num_pages, sizeof(int));
+    }
+
+    long slot = proc->virtual_time % sys->tau;
+    int outgoing = proc->ws_window[slot];
+    proc->ws_window[slot] = page_number;
+    if (proc->ws_count[page_number]++ == 0) proc->ws_size++;
+
+    // La entrada no es válida hasta que la ventana se ha llenado una vez
+    if (proc->virtual_time >= sys->tau && --proc->ws_count[outgoing] == 0) {
+        proc->ws_size--;
+        if (sys->policy == POLICY_WORKING_SET && proc->table[outgoing].presence_bit) {
+            release_page(sys, proc, outgoing);
+        }
+    }
+}
+
+/**
+ * Función: pff_on_fault
+ * Descripción: Política PFF, aplicada en cada fallo. Si ha pasado más de τ desde
+ *              el fallo anterior la tasa de fallos es baja y el conjunto residente
+ *              se recorta a las páginas referenciadas desde entonces; si no, el
+ *              conjunto simplemente crece con la página que falla.
+ */
+static void pff_on_fault(PagingSystem *sys, Process *proc) {
+    if (proc->virtual_time - proc->last_fault_time > sys->tau) {
+        for (int page = 0; page < proc->num_pages; page++) {
+            PageTableEntry *entry = &proc->table[page];
+            if (!entry->presence_bit) continue;
+            if (entry->referenced_bit) {
+                entry->referenced_bit = 0;
+            } else {
+                release_page(sys, proc, page);
+            }
+        }
+    }
+    proc->last_fault_time = proc->virtual_time;
+}
+
+/**
+ * Función: ksm_break_cow
+ * Descripción: Escritura sobre una página fusionada: si el marco compartido
+ *              sigue teniendo otras páginas se copia a un marco propio; si era la
+ *              última, la página se queda con el marco.
+ */
+static void ksm_break_cow(PagingSystem *sys, Process *proc, int page_number) {
+    PageTableEntry *entry = &proc->table[page_number];
+    int shared = entry->page_frame;
+    int frame = shared;
+
+    if (sys->frames[shared].sharers > 1) {
+        frame = alloc_frame(sys);
+        memcpy(frame_data(sys, frame), frame_data(sys, shared), PAGE_SIZE);
+        sys->frames[shared].sharers--;
+    } else {
+        sys->frames[shared].ksm = 0;
+    }
+    FrameInfo *info = &sys->frames[frame];
+    info->owner = proc;
+    info->page_number = page_number;
+    info->sharers = 1;
+    info->heat = 0;
+    entry->page_frame = frame;
+    entry->cow_bit = 0;
+    proc->resident_pages++;
+    sys->stats.ksm_cow_breaks++;
+}
+
+/**
+ * Función: zero_page_break
+ * Descripción: Primera escritura sobre una página proyectada en el marco cero:
+ *              la página recibe un marco propio lleno de ceros, que es lo que
+ *              ya había leído. Cuenta como fallo, pero no como primer acceso.
+ */
+static void zero_page_break(PagingSystem *sys, Process *proc, int page_number) {
+    PageTableEntry *entry = &proc->table[page_number];
+    int frame = alloc_frame(sys);
+
+    memset(frame_data(sys, frame), 0, PAGE_SIZE);
+    FrameInfo *info = &sys->frames[frame];
+    info->owner = proc;
+    info->page_number = page_number;
+    info->sharers = 1;
+    info->heat = 0;
+    info->checksum = 0;
+    entry->page_frame = frame;
+    entry->cow_bit = 0;
+    proc->resident_pages++;
+    sys->stats.faults++;
+    sys->stats.access_time_ns += PAGE_FAULT_TIME;
+    sys->stats.zero_page_breaks++;
+}
+
+// Cuerpo de paging_access; con hilos en segundo plano activos se llama con sys->lock tomado
+static int paging_access_unlocked(PagingSystem *sys, Process *proc, uint32_t virtual_address, int is_write) {
+    int page_number = virtual_address >> 12;
+    int offset = virtual_address & (PAGE_SIZE - 1);
+
+    PageTableEntry *entry = &proc->table[page_number];
+    sys->stats.accesses++;
+    if (entry->presence_bit && is_write && entry->page_frame == sys->zero_frame) {
+        zero_page_break(sys, proc, page_number);
+    } else if (entry->presence_bit && is_write && entry->cow_bit) {
+        ksm_break_cow(sys, proc, page_number);
+    }
+    if (entry->presence_bit == 0) {
+        if (sys->policy == POLICY_PFF) pff_on_fault(sys, proc);
+        handle_page_fault(sys, proc, page_number, is_write);
+    }
+    sys->stats.access_time_ns += frame_access_time(sys, entry->page_frame);
+    if (sys->dram_frames) {
+        if (entry->page_frame < sys->dram_frames) sys->stats.dram_accesses++;
+        if (sys->stats.accesses % MIGRATION_INTERVAL == 0) tier_migration_scan(sys);
+    }
+
+    entry->referenced_bit = 1;
+    if (is_write) {
+        uint64_t value = sys->stats.accesses;
+        entry->modified_bit = 1;
+        memcpy(frame_data(sys, entry->page_frame) + (offset & ~7), &value, sizeof(value));
+    }
+    int physical_address = entry->page_frame * PAGE_SIZE + offset;
+
+    if (sys->tau > 0) working_set_update(sys, proc, page_number);
+    proc->virtual_time++;
+    return physical_address;
+}
+
+/**
+ * Función: paging_access
+ * Descripción: Simula un acceso de un proceso a una dirección virtual. Si la
+ *              página no está en memoria se atiende el fallo. Las escrituras
+ *              guardan un contador en la posición accedida. Si hay hilo
+ *              reclamador o de fusión, el acceso se hace con el cerrojo del simulador.
+ * Parámetros:
+ *   - sys: simulador.
+ *   - proc: proceso que accede.
+ *   - virtual_address: dirección virtual (número de página en los bits 12 en adelante).
+ *   - is_write: 1 si el acceso es una escritura.
+ * Retorno:
+ *   - Dirección física accedida, o -1 si la página está fuera del proceso.
+ */
+int paging_access(PagingSystem *sys, Process *proc, uint32_t virtual_address, int is_write) {
+    int page_number = virtual_address >> 12;
+    if (page_number >= proc->num_pages) return -1;
+    if (sys->background_threads == 0) return paging_access_unlocked(sys, proc, virtual_address, is_write);
+
+    pthread_mutex_lock(&sys->lock);
+    int physical_address = paging_access_unlocked(sys, proc, virtual_address, is_write);
+    pthread_mutex_unlock(&sys->lock);
+    return physical_address;
+}
+
+// Generador de accesos con localidad: un conjunto caliente que se desplaza por fases
+typedef struct {
+    uint64_t rng;
+    int num_pages;          // Páginas del proceso
+    int hot_pages;          // Tamaño del conjunto caliente
+    double hot_fraction;    // Probabilidad de acceder al conjunto caliente
+    double write_fraction;  // Probabilidad de que el acceso sea una escritura
+    long phase_length;      // Accesos antes de desplazar el conjunto caliente
+    long generated;
+} Workload;
+
+/**
+ * Función: workload_next
+ * Descripción: Genera la siguiente dirección virtual del patrón de accesos.
+ * Parámetros:
+ *   - w: generador.
+ *   - is_write: salida, 1 si el acceso es una escritura.
+ * Retorno:
+ *   - Dirección virtual.
+ */
+uint32_t workload_next(Workload *w, int *is_write) {
+    int hot_base = (int)((w->generated / w->phase_length) * (w->hot_pages / 2) % w->num_pages);
+    int page;
+    if (rng_uniform(&w->rng) < w->hot_fraction) {
+        page = (hot_base + rng_next(&w->rng) % w->hot_pages) % w->num_pages;
+    } else {
+        page = rng_next(&w->rng) % w->num_pages;
+    }
+    w->generated++;
+    *is_write = rng_uniform(&w->rng) < w->write_fraction;
+    return ((uint32_t)page << 12) | (rng_next(&w->rng) & (PAGE_SIZE - 1));
+}
+
+/**
+ * Función: workload_phased
+ * Descripción: Crea un generador cuyo conjunto caliente se desplaza 'phases'
+ *              veces a lo largo de una ejecución de num_accesses accesos, de
+ *              modo que el cambio de fase ocurre igual con trazas cortas y
+ *              largas. Cada fase dura al menos un acceso, así que cualquier
+ *              número positivo de accesos es válido.
+ */
+Workload workload_phased(uint64_t seed, int num_pages, int hot_pages, double hot_fraction,
+                         double write_fraction, long num_accesses, int phases) {
+    long phase_length = num_accesses / phases;
+    return (Workload){seed, num_pages, hot_pages, hot_fraction, write_fraction,
+                      phase_length > 0 ? phase_length : 1, 0};
+}
+
+/**
+ * Función: run_zswap_comparison
+ * Descripción: Ejecuta la misma secuencia de accesos con swap directo y con la
+ *              caché comprimida, e informa de la tasa de compresión, el tiempo
+ *              de CPU extra y el cambio en el tiempo medio de acceso (AMAT).
+ *              El AMAT usa los costes modelados ZSWAP_COMPRESS_TIME y
+ *              ZSWAP_DECOMPRESS_TIME; el tiempo medido en esta máquina se
+ *              informa aparte.
+ * Parámetros:
+ *   - num_accesses: número de accesos a simular.
+ */
+void run_zswap_comparison(long num_accesses) {
+    const char *names[] = {"swap directo", "caché comprimida"};
+    PagingStats results[2];
+    PagingSystem *sys = malloc(sizeof(PagingSystem));
+
+    printf("Simulación de %ld accesos sobre %d marcos (%d KB de RAM)\n",
+           num_accesses, NUM_FRAMES, NUM_FRAMES * PAGE_SIZE / 1024);
+    for (int use_zswap = 0; use_zswap <= 1; use_zswap++) {
+        paging_init(sys, use_zswap);
+        Process *proc = process_create(1, 2048);
+        Workload w = {0x2545F4914F6CDD1DULL, proc->num_pages, 560, 0.97, 0.3, 200000, 0};
+
+        for (long i = 0; i < num_accesses; i++) {
+            int is_write;
+            uint32_t address = workload_next(&w, &is_write);
+            paging_access(sys, proc, address, is_write);
+        }
+        results[use_zswap] = sys->stats;
+        process_destroy(proc);
+        paging_destroy(sys);
+
+        PagingStats *s = &results[use_zswap];
+        printf("\n%s:\n", names[use_zswap]);
+        printf(" - Fallos de página: %ld (%ld primer acceso, %ld desde swap, %ld desde la caché)\n",
+               s->faults, s->first_touch, s->major_faults, s->zswap_loads);
+        printf(" - Escrituras en swap: %ld\n", s->swap_writes);
+        if (use_zswap) {
+            printf(" - Tasa de compresión: %.2f:1 (%ld páginas guardadas, %ld rechazadas, %ld expulsadas a swap)\n",
+                   s->compressed_bytes ? (double)s->stored_bytes / s->compressed_bytes : 0.0,
+                   s->zswap_stores, s->zswap_rejects, s->zswap_writebacks);
+            printf(" - CPU extra medida: %.2f ms en compresión, %.2f ms en descompresión"
+                   " (modelo: %d y %d ns por página)\n",
+                   s->compress_ns / 1e6, s->decompress_ns / 1e6, ZSWAP_COMPRESS_TIME, ZSWAP_DECOMPRESS_TIME);
+        }
+        printf(" - Tiempo medio de acceso (AMAT): %.2f ns\n", s->access_time_ns / s->accesses);
+    }
+
+    double amat_direct = results[0].access_time_ns / results[0].accesses;
+    double amat_zswap = results[1].access_time_ns / results[1].accesses;
+    printf("\nCambio de AMAT con la caché comprimida: %+.2f ns (%+.1f%%)\n",
+           amat_zswap - amat_direct, 100.0 * (amat_zswap - amat_direct) / amat_direct);
+    free(sys);
+}
+
+/**
+ * Función: run_tier_comparison
+ * Descripción: Simula una carga que cabe en la memoria física con distintos
+ *              tamaños de DRAM, con y sin migración, e informa del AMAT, de la
+ *              fracción de accesos servidos desde DRAM y del ancho de banda de
+ *              migración (respecto al tiempo simulado). Sirve para dimensionar
+ *              cuánta memoria lejana admite una carga sin penalizar el AMAT.
+ * Parámetros:
+ *   - num_accesses: número de accesos por configuración.
+ */
+void run_tier_comparison(long num_accesses) {
+    PagingSystem *sys = malloc(sizeof(PagingSystem));
+
+    printf("Memoria en dos niveles: DRAM %d ns, lejana %d ns, %ld accesos por configuración\n",
+           MEMORY_ACCESS_TIME, FAR_MEMORY_ACCESS_TIME, num_accesses);
+    printf("%-6s %-10s %12s %10s %12s %16s\n", "DRAM", "migración", "AMAT (ns)", "% en DRAM",
+           "migraciones", "ancho banda MB/s");
+    for (int quarter = 1; quarter <= 4; quarter++) {
+        for (int migration = 0; migration <= 1; migration++) {
+            if (quarter == 4 && migration) continue; // Todo en DRAM: no hay nada que migrar
+            paging_init(sys, 0);
+            paging_set_tiers(sys, NUM_FRAMES * quarter / 4, migration);
+            Process *proc = process_create(1, NUM_FRAMES - 12);
+            Workload w = {0x9E3779B97F4A7C15ULL, proc->num_pages, 96, 0.9, 0.3, 100000, 0};
+
+            for (long i = 0; i < num_accesses; i++) {
+                int is_write;
+                uint32_t address = workload_next(&w, &is_write);
+                paging_access(sys, proc, address, is_write);
+            }
+
+            PagingStats *st = &sys->stats;
+            double seconds = st->access_time_ns / 1e9;
+            // "sí" ocupa 3 bytes en UTF-8: se amplía el ancho para que la columna quede alineada
+            printf("%4d%%  %-*s %12.2f %9.1f%% %12ld %16.2f\n", quarter * 25,
+                   migration ? 11 : 10, migration ? "sí" : "no",
+                   st->access_time_ns / st->accesses, 100.0 * st->dram_accesses / st->accesses,
+                   st->migrations, st->migrations * (double)PAGE_SIZE / seconds / 1e6);
+            process_destroy(proc);
+            paging_destroy(sys);
+        }
+    }
+    free(sys);
+}
+
+#define WS_SAMPLES 20          // Muestras de la serie temporal del conjunto de trabajo
+#define WS_DEFAULT_TAU 5000    // Ventana τ por defecto, en referencias
+#define PFF_DEFAULT_TAU 300    // Intervalo entre fallos por encima del cual PFF recorta, en referencias
+
+/**
+ * Función: run_working_set_comparison
+ * Descripción: Ejecuta la misma secuencia de accesos con el reloj, WS(τ) y PFF.
+ *              Muestra la evolución del tamaño del conjunto de trabajo y del
+ *              conjunto residente de cada política, un resumen de fallos y
+ *              memoria media, y un barrido de τ para WS que permite localizar la
+ *              memoria residente mínima antes de que la tasa de fallos se dispare.
+ * Parámetros:
+ *   - num_accesses: número de accesos por simulación.
+ */
+void run_working_set_comparison(long num_accesses) {
+    const char *names[] = {"reloj", "WS", "PFF"};
+    ReplacementPolicy policies[] = {POLICY_CLOCK, POLICY_WORKING_SET, POLICY_PFF};
+    PagingSystem *systems[3];
+    Process *procs[3];
+    Workload loads[3];
+    double resident_sum[3] = {0, 0, 0};
+    int resident_max[3] = {0, 0, 0};
+
+    for (int i = 0; i < 3; i++) {
+        systems[i] = malloc(sizeof(PagingSystem));
+        paging_init(systems[i], 0);
+        paging_set_policy(systems[i], policies[i], policies[i] == POLICY_PFF ? PFF_DEFAULT_TAU : WS_DEFAULT_TAU);
+        procs[i] = process_create(1, 2048);
+        loads[i] = workload_phased(0xD1B54A32D192ED03ULL, 2048, 200, 0.99, 0.3, num_accesses, 8);
+    }
+
+    long sample_every = num_accesses >= WS_SAMPLES ? num_accesses / WS_SAMPLES : 1;
+    printf("Conjunto de trabajo con τ = %d referencias, PFF con τ = %d (%ld accesos, %d marcos)\n",
+           WS_DEFAULT_TAU, PFF_DEFAULT_TAU, num_accesses, NUM_FRAMES);
+    printf("%10s %10s %14s %14s %14s\n", "t", "W(t,τ)", "resid. reloj", "resid. WS", "resid. PFF");
+    for (long t = 1; t <= num_accesses; t++) {
+        for (int i = 0; i < 3; i++) {
+            int is_write;
+            uint32_t address = workload_next(&loads[i], &is_write);
+            paging_access(systems[i], procs[i], address, is_write);
+            resident_sum[i] += procs[i]->resident_pages;
+            if (procs[i]->resident_pages > resident_max[i]) resident_max[i] = procs[i]->resident_pages;
+        }
+        if (t % sample_every == 0) {
+            printf("%10ld %10d %14d %14d %14d\n", t, procs[0]->ws_size, procs[0]->resident_pages,
+                   procs[1]->resident_pages, procs[2]->resident_pages);
+        }
+    }
+
+    printf("\nResumen:\n");
+    for (int i = 0; i < 3; i++) {
+        PagingStats *st = &systems[i]->stats;
+        printf(" - %-6s fallos: %7ld (%.2f por 1000 refs), residentes medias: %6.1f, máximas: %d\n",
+               names[i], st->faults, 1000.0 * st->faults / st->accesses,
+               resident_sum[i] / num_accesses, resident_max[i]);
+        process_destroy(procs[i]);
+        paging_destroy(systems[i]);
+    }
+
+    printf("\nBarrido de τ con WS (memoria mínima antes de la hiperpaginación):\n");
+    printf("%8s %16s %18s\n", "τ", "fallos/1000 refs", "residentes medias");
+    for (long tau = 500; tau <= 40000; tau *= 2) {
+        PagingSystem *sys = systems[0];
+        paging_init(sys, 0);
+        paging_set_policy(sys, POLICY_WORKING_SET, tau);
+        Process *proc = process_create(1, 2048);
+        Workload w = workload_phased(0xD1B54A32D192ED03ULL, 2048, 200, 0.99, 0.3, num_accesses, 8);
+        double sum = 0;
+        for (long t = 0; t < num_accesses; t++) {
+            int is_write;
+            uint32_t address = workload_next(&w, &is_write);
+            paging_access(sys, proc, address, is_write);
+            sum += proc->resident_pages;
+        }
+        printf("%8ld %16.2f %18.1f\n", tau, 1000.0 * sys->stats.faults / sys->stats.accesses, sum / num_accesses);
+        process_destroy(proc);
+        paging_destroy(sys);
+    }
+
+    for (int i = 0; i < 3; i++) free(systems[i]);
+}
+
+/* ------------------------------------------------------------------------
+ * Planificación a medio plazo y control de admisión
+ * ------------------------------------------------------------------------
+ * Varios procesos comparten los marcos con el reloj global. Se simula una CPU
+ * y un dispositivo de swap que atiende las lecturas en orden: un fallo que lee
+ * de swap bloquea al proceso hasta que termina su lectura y la CPU pasa al
+ * siguiente proceso listo. Cada ventana de THRASHING_WINDOW_NS de tiempo
+ * simulado se mide la tasa de fallos y los accesos útiles; si la tasa supera el
+ * umbral mientras los accesos útiles caen, se suspende el proceso con mayor
+ * conjunto residente, y se reanuda cuando la tasa de fallos vuelve a ser baja.
+ */
+
+#define SCHED_QUANTUM 2000              // Accesos por turno de CPU
+#define THRASHING_WINDOW_NS 20e6        // Ventana de detección: 20 ms de tiempo simulado
+#define THRASHING_FAULT_RATE 5.0        // Fallos de swap por 1000 accesos que indican hiperpaginación
+#define THRASHING_THROUGHPUT_DROP 0.5   // Accesos útiles por debajo de esta fracción del máximo observado
+#define RESUME_FAULT_RATE 1.0           // Fallos por 1000 accesos por debajo de los cuales se reanuda un proceso
+#define ADMISSION_COOLDOWN 2            // Ventanas de espera tras suspender o reanudar
+#define THRASHING_MAX_PROCS 64          // Grado de multiprogramación máximo del barrido
+
+// Estados de un proceso en el planificador
+typedef enum {
+    PROC_READY,      // Listo para ejecutar
+    PROC_BLOCKED,    // Esperando una lectura de swap
+    PROC_SUSPENDED,  // Suspendido por el control de admisión (sin páginas residentes)
+    PROC_DONE        // Terminado
+} ProcessState;
+
+// Proceso bajo el planificador: espacio de direcciones, carga y estado
+typedef struct {
+    Process *proc;
+    Workload load;
+    long remaining;         // Accesos que le quedan por ejecutar
+    ProcessState state;
+    double blocked_until;   // Fin de su lectura de swap pendiente (ns simulados)
+    long suspended_at;      // Orden de suspensión, para reanudar el más antiguo primero
+} ScheduledProcess;
+
+// Resultado de una ejecución del planificador
+typedef struct {
+    double makespan_ns;     // Tiempo hasta que terminan todos los procesos
+    double cpu_busy_ns;     // Tiempo de CPU ocupada
+    long accesses;
+    long major_faults;
+    int suspensions;
+} ScheduleResult;
+
+/**
+ * Función: run_multiprogrammed
+ * Descripción: Ejecuta num_procs procesos hasta completar sus accesos bajo el
+ *              planificador descrito arriba.
+ * Parámetros:
+ *   - num_procs: número de procesos.
+ *   - accesses_per_proc: accesos que ejecuta cada proceso.
+ *   - admission_control: 1 para activar la detección de hiperpaginación.
+ * Retorno:
+ *   - Estadísticas de la ejecución.
+ */
+ScheduleResult run_multiprogrammed(int num_procs, long accesses_per_proc, int admission_control) {
+    PagingSystem *sys = malloc(sizeof(PagingSystem));
+    ScheduledProcess *sp = calloc(num_procs, sizeof(ScheduledProcess));
+    ScheduleResult result = {0, 0, 0, 0, 0};
+    double now = 0, disk_free_at = 0, window_end = THRASHING_WINDOW_NS;
+    long window_accesses = 0, window_faults = 0, peak_window_accesses = 0, suspend_order = 0;
+    int done = 0, next = 0, cooldown = 0;
+
+    paging_init(sys, 0);
+    for (int i = 0; i < num_procs; i++) {
+        sp[i].proc = process_create(i + 1, 400);
+        sp[i].load = workload_phased(0x9E3779B97F4A7C15ULL * (i + 1), 400, 150, 0.99, 0.3, accesses_per_proc, 2);
+        sp[i].remaining = accesses_per_proc;
+        sp[i].state = PROC_READY;
+    }
+
+    while (done < num_procs) {
+        // Fin de ventana: detección de hiperpaginación
+        while (now >= window_end) {
+            double fault_rate = 1000.0 * window_faults / (window_accesses ? window_accesses : 1);
+            if (window_accesses > peak_window_accesses) peak_window_accesses = window_accesses;
+            int active = 0, suspended = -1, victim = -1;
+            for (int i = 0; i < num_procs; i++) {
+                if (sp[i].state == PROC_READY || sp[i].state == PROC_BLOCKED) {
+                    active++;
+                    if (victim == -1 || sp[i].proc->resident_pages > sp[victim].proc->resident_pages) victim = i;
+                } else if (sp[i].state == PROC_SUSPENDED &&
+                           (suspended == -1 || sp[i].suspended_at < sp[suspended].suspended_at)) {
+                    suspended = i;
+                }
+            }
+
+            if (admission_control && cooldown == 0) {
+                if (fault_rate > THRASHING_FAULT_RATE && active > 1 &&
+                    window_accesses < THRASHING_THROUGHPUT_DROP * peak_window_accesses) {
+                    paging_swap_out_process(sys, sp[victim].proc);
+                    sp[victim].state = PROC_SUSPENDED;
+                    sp[victim].suspended_at = suspend_order++;
+                    result.suspensions++;
+                    cooldown = ADMISSION_COOLDOWN;
+                } else if (fault_rate < RESUME_FAULT_RATE && suspended != -1) {
+                    sp[suspended].state = PROC_READY;
+                    cooldown = ADMISSION_COOLDOWN;
+                }
+            } else if (cooldown > 0) {
+                cooldown--;
+            }
+            window_accesses = window_faults = 0;
+            window_end += THRASHING_WINDOW_NS;
+        }
+
+        // Siguiente proceso listo en turno rotatorio
+        int chosen = -1;
+        double earliest = -1;
+        for (int k = 0; k < num_procs; k++) {
+            int i = (next + k) % num_procs;
+            if (sp[i].state == PROC_BLOCKED && sp[i].blocked_until <= now) sp[i].state = PROC_READY;
+            if (sp[i].state == PROC_READY && chosen == -1) chosen = i;
+            if (sp[i].state == PROC_BLOCKED && (earliest < 0 || sp[i].blocked_until < earliest)) {
+                earliest = sp[i].blocked_until;
+            }
+        }
+        if (chosen == -1) {
+            if (earliest >= 0) {
+                now = earliest < window_end ? earliest : window_end; // CPU ociosa
+                continue;
+            }
+            // Todos los procesos restantes están suspendidos: se reanuda el más antiguo
+            int oldest = -1;
+            for (int i = 0; i < num_procs; i++) {
+                if (sp[i].state == PROC_SUSPENDED && (oldest == -1 || sp[i].suspended_at < sp[oldest].suspended_at)) {
+                    oldest = i;
+                }
+            }
+            sp[oldest].state = PROC_READY;
+            continue;
+        }
+        next = (chosen + 1) % num_procs;
+
+        // Turno de CPU: hasta SCHED_QUANTUM accesos o hasta el primer fallo de swap
+        ScheduledProcess *p = &sp[chosen];
+        for (int q = 0; q < SCHED_QUANTUM && p->remaining > 0; q++) {
+            int is_write;
+            uint32_t address = workload_next(&p->load, &is_write);
+            double time_before = sys->stats.access_time_ns;
+            long majors_before = sys->stats.major_faults;
+            paging_access(sys, p->proc, address, is_write);
+
+            int major = sys->stats.major_faults != majors_before;
+            double cpu = sys->stats.access_time_ns - time_before - (major ? SWAP_ACCESS_TIME : 0);
+            now += cpu;
+            result.cpu_busy_ns += cpu;
+            p->remaining--;
+            window_accesses++;
+            if (major) {
+                window_faults++;
+                disk_free_at = (disk_free_at > now ? disk_free_at : now) + SWAP_ACCESS_TIME;
+                p->blocked_until = disk_free_at;
+                p->state = PROC_BLOCKED;
+                break;
+            }
+        }
+        if (p->remaining == 0) {
+            paging_process_exit(sys, p->proc);
+            p->state = PROC_DONE;
+            done++;
+            // Un proceso que termina libera memoria: oportunidad de reanudar a otro
+            if (cooldown > 0) cooldown--;
+        }
+    }
+
+    result.makespan_ns = now > disk_free_at ? now : disk_free_at;
+    result.accesses = sys->stats.accesses;
+    result.major_faults = sys->stats.major_faults;
+    for (int i = 0; i < num_procs; i++) process_destroy(sp[i].proc);
+    paging_destroy(sys);
+    free(sp);
+    free(sys);
+    return result;
+}
+
+/**
+ * Función: run_thrashing_comparison
+ * Descripción: Ejecuta la carga multiprogramada con y sin control de admisión
+ *              para grados de multiprogramación crecientes, e informa del
+ *              rendimiento (accesos útiles por segundo simulado), la tasa de
+ *              fallos y las suspensiones realizadas.
+ * Parámetros:
+ *   - max_procs: número máximo de procesos simultáneos.
+ */
+void run_thrashing_comparison(int max_procs) {
+    const long accesses_per_proc = 300000;
+
+    printf("Hiperpaginación con %d marcos: conjuntos calientes de 150 páginas por proceso\n", NUM_FRAMES);
+    printf("%8s %-10s %16s %16s %10s %12s\n", "procesos", "admisión", "M accesos/s", "fallos/1000",
+           "CPU útil", "suspensiones");
+    for (int n = 1; n <= max_procs; n++) {
+        for (int admission = 0; admission <= 1; admission++) {
+            ScheduleResult r = run_multiprogrammed(n, accesses_per_proc, admission);
+            printf("%8d %-10s %16.2f %16.2f %9.1f%% %12d\n", n, admission ? "activa" : "inactiva",
+                   r.accesses / (r.makespan_ns / 1e9) / 1e6, 1000.0 * r.major_faults / r.accesses,
+                   100.0 * r.cpu_busy_ns / r.makespan_ns, r.suspensions);
+        }
+    }
+}
+
+/**
+ * Función: latency_percentile
+ * Descripción: Percentil aproximado de un histograma log2: devuelve el límite
+ *              superior de la cubeta en la que cae el percentil.
+ */
+static long latency_percentile(const long *hist, double percentile) {
+    long total = 0, seen = 0;
+    for (int b = 0; b < FAULT_LATENCY_BUCKETS; b++) total += hist[b];
+    for (int b = 0; b < FAULT_LATENCY_BUCKETS; b++) {
+        seen += hist[b];
+        if (seen >= percentile * total) return 1L << (b + 1);
+    }
+    return 1L << FAULT_LATENCY_BUCKETS;
+}
+
+/**
+ * Función: run_reclaimer_comparison
+ * Descripción: Ejecuta la misma carga sin y con el hilo reclamador. El hilo de
+ *              la aplicación espera SWAP_ACCESS_TIME fuera del cerrojo en cada
+ *              lectura de swap, como un proceso bloqueado en E/S, y en ese
+ *              tiempo el reclamador puede trabajar. Informa del número de
+ *              reclamaciones directas y de la distribución de latencia de los fallos.
+ *              Con el reclamador hay más fallos: mantiene libres entre
+ *              WATERMARK_LOW y WATERMARK_HIGH marcos que la carga no usa.
+ * Parámetros:
+ *   - num_accesses: número de accesos por ejecución.
+ */
+void run_reclaimer_comparison(long num_accesses) {
+    PagingSystem *sys = malloc(sizeof(PagingSystem));
+    struct timespec device_wait = {0, SWAP_ACCESS_TIME};
+
+    printf("Reclamación con marcas de agua min/baja/alta = %d/%d/%d marcos, %ld accesos\n",
+           WATERMARK_MIN, WATERMARK_LOW, WATERMARK_HIGH, num_accesses);
+    for (int background = 0; background <= 1; background++) {
+        paging_init(sys, 0);
+        if (background) paging_start_reclaimer(sys, WATERMARK_MIN, WATERMARK_LOW, WATERMARK_HIGH);
+        Process *proc = process_create(1, 1024);
+        Workload w = workload_phased(0xA0761D6478BD642FULL, proc->num_pages, 540, 0.99, 0.3, num_accesses, 4);
+
+        double start = now_seconds();
+        for (long i = 0; i < num_accesses; i++) {
+            int is_write;
+            uint32_t address = workload_next(&w, &is_write);
+            long majors_before = sys->stats.major_faults;
+            paging_access(sys, proc, address, is_write);
+            if (sys->stats.major_faults != majors_before) nanosleep(&device_wait, NULL);
+        }
+        double elapsed = now_seconds() - start;
+        if (background) paging_stop_reclaimer(sys);
+
+        PagingStats *st = &sys->stats;
+        printf("\n%s:\n", background ? "Con reclamador en segundo plano" : "Sólo reclamación directa");
+        printf(" - Fallos: %ld, reclamaciones directas: %ld (%.1f%% de los fallos), páginas del reclamador: %ld\n",
+               st->faults, st->direct_reclaims, st->faults ? 100.0 * st->direct_reclaims / st->faults : 0.0,
+               st->background_reclaims);
+        printf(" - Latencia del manejador de fallos: p50 < %ld ns, p90 < %ld ns, p99 < %ld ns\n",
+               latency_percentile(st->fault_latency_hist, 0.50), latency_percentile(st->fault_latency_hist, 0.90),
+               latency_percentile(st->fault_latency_hist, 0.99));
+        printf(" - Histograma:");
+        for (int b = 0; b < FAULT_LATENCY_BUCKETS; b++) {
+            if (st->fault_latency_hist[b]) printf(" [%ld ns: %ld]", 1L << b, st->fault_latency_hist[b]);
+        }
+        printf("\n - Tiempo real de la ejecución: %.2f s\n", elapsed);
+        process_destroy(proc);
+        paging_destroy(sys);
+    }
+    free(sys);
+}
+
+/* ------------------------------------------------------------------------
+ * fork con copia en escritura
+ * ------------------------------------------------------------------------
+ * Para espacios de direcciones grandes la tabla de páginas es de dos niveles:
+ * un directorio de punteros a tablas hoja de PageTableEntry. Cada marco lleva
+ * un contador de referencias (tablas hoja que lo apuntan). fork puede copiar
+ * todas las tablas hoja de inmediato, marcando cada entrada de sólo lectura
+ * (cow_bit), o compartirlas con un contador de referencias y copiar cada hoja
+ * la primera vez que uno de los procesos escribe en su rango.
+ */
+
+#define COW_LEAF_ENTRIES 512       // Entradas por tabla hoja (como una tabla de x86-64)
+#define FORK_MIN_PAGES 1024        // Páginas mínimas del padre: caben varias regiones escritas por el hijo
+#define FORK_MAX_PAGES (1 << 17)   // Páginas máximas del padre (512MB): la reserva de marcos es el doble (1GB)
+
+// Modo de duplicación del espacio de direcciones en fork
+typedef enum {
+    FORK_FULL_COPY,        // Sin copia en escritura: se copian tablas y marcos
+    FORK_COW_EAGER,        // Copia en escritura, tablas hoja copiadas en el fork
+    FORK_COW_ON_DEMAND     // Copia en escritura, tablas hoja compartidas hasta la primera escritura
+} ForkMode;
+
+// Conjunto de marcos con contenido y contador de referencias
+typedef struct {
+    uint8_t *memory;
+    int *refcount;          // Tablas hoja que apuntan a cada marco (0 = libre)
+    int *free_stack;
+    int num_frames;
+    int num_free;
+    long frame_copies;      // Marcos copiados al romper la compartición
+} FramePool;
+
+// Tabla hoja, compartible entre procesos tras un fork bajo demanda
+typedef struct {
+    PageTableEntry entries[COW_LEAF_ENTRIES];
+    int refcount;           // Espacios de direcciones que la comparten
+} PageTableLeaf;
+
+// Espacio de direcciones con tabla de páginas de dos niveles
+typedef struct {
+    PageTableLeaf **directory;
+    int num_leaves;
+    FramePool *pool;
+    long leaf_copies;       // Tablas hoja copiadas al romper la compartición
+} AddressSpace;
+
+FramePool *frame_pool_create(int num_frames) {
+    FramePool *pool = malloc(sizeof(FramePool));
+    pool->memory = malloc((size_t)num_frames * PAGE_SIZE);
+    pool->refcount = calloc(num_frames, sizeof(int));
+    pool->free_stack = malloc(num_frames * sizeof(int));
+    if (pool->memory == NULL || pool->refcount == NULL || pool->free_stack == NULL) {
+        fprintf(stderr, "No hay memoria para un conjunto de %d marcos (%zu MB)\n", num_frames,
+                (size_t)num_frames * PAGE_SIZE >> 20);
+        exit(1);
+    }
+    pool->num_frames = num_frames;
+    pool->num_free = 0;
+    pool->frame_copies = 0;
+    for (int f = num_frames - 1; f >= 0; f--) pool->free_stack[pool->num_free++] = f;
+    return pool;
+}
+
+void frame_pool_destroy(FramePool *pool) {
+    free(pool->memory);
+    free(pool->refcount);
+    free(pool->free_stack);
+    free(pool);
+}
+
+static int frame_pool_alloc(FramePool *pool) {
+    if (pool->num_free == 0) {
+        fprintf(stderr, "Conjunto de marcos agotado\n");
+        exit(1);
+    }
+    int frame = pool->free_stack[--pool->num_free];
+    pool->refcount[frame] = 1;
+    return frame;
+}
+
+static void frame_pool_put(FramePool *pool, int frame) {
+    if (--pool->refcount[frame] == 0) pool->free_stack[pool->num_free++] = frame;
+}
+
+static uint8_t *pool_frame_data(FramePool *pool, int frame) {
+    return pool->memory + (size_t)frame * PAGE_SIZE;
+}
+
+/**
+ * Función: address_space_create
+ * Descripción: Crea un espacio de direcciones con todas sus páginas presentes
+ *              y con contenido, como un proceso que ya ha inicializado su memoria.
+ */
+AddressSpace *address_space_create(FramePool *pool, int num_pages) {
+    AddressSpace *as = malloc(sizeof(AddressSpace));
+    as->pool = pool;
+    as->num_leaves = (num_pages + COW_LEAF_ENTRIES - 1) / COW_LEAF_ENTRIES;
+    as->directory = malloc(as->num_leaves * sizeof(PageTableLeaf *));
+    as->leaf_copies = 0;
+    for (int l = 0; l < as->num_leaves; l++) {
+        PageTableLeaf *leaf = calloc(1, sizeof(PageTableLeaf));
+        leaf->refcount = 1;
+        for (int i = 0; i < COW_LEAF_ENTRIES && l * COW_LEAF_ENTRIES + i < num_pages; i++) {
+            int frame = frame_pool_alloc(pool);
+            fill_page_contents(pool_frame_data(pool, frame), 1, l * COW_LEAF_ENTRIES + i);
+            leaf->entries[i] = (PageTableEntry){1, 1, frame, 0, 0};
+        }
+        as->directory[l] = leaf;
+    }
+    return as;
+}
+
+/**
+ * Función: leaf_copy_cow
+ * Descripción: Copia una tabla hoja para un nuevo propietario. Las páginas
+ *              presentes quedan de sólo lectura en ambas copias y cada marco
+ *              gana una referencia.
+ */
+static PageTableLeaf *leaf_copy_cow(FramePool *pool, PageTableLeaf *leaf) {
+    PageTableLeaf *copy = malloc(sizeof(PageTableLeaf));
+    for (int i = 0; i < COW_LEAF_ENTRIES; i++) {
+        PageTableEntry *entry = &leaf->entries[i];
+        if (entry->presence_bit) {
+            entry->cow_bit = 1;
+            pool->refcount[entry->page_frame]++;
+        }
+        copy->entries[i] = *entry;
+    }
+    copy->refcount = 1;
+    return copy;
+}
+
+/**
+ * Función: address_space_fork
+ * Descripción: Duplica un espacio de direcciones según el modo indicado.
+ * Parámetros:
+ *   - parent: espacio de direcciones del padre.
+ *   - mode: copia completa, copia en escritura con tablas copiadas, o copia en
+ *           escritura con tablas compartidas hasta la primera escritura.
+ * Retorno:
+ *   - Espacio de direcciones del hijo.
+ */
+AddressSpace *address_space_fork(AddressSpace *parent, ForkMode mode) {
+    FramePool *pool = parent->pool;
+    AddressSpace *child = malloc(sizeof(AddressSpace));
+    child->pool = pool;
+    child->num_leaves = parent->num_leaves;
+    child->directory = malloc(child->num_leaves * sizeof(PageTableLeaf *));
+    child->leaf_copies = 0;
+
+    for (int l = 0; l < parent->num_leaves; l++) {
+        PageTableLeaf *leaf = parent->directory[l];
+        if (mode == FORK_COW_ON_DEMAND) {
+            leaf->refcount++;
+            child->directory[l] = leaf;
+        } else if (mode == FORK_COW_EAGER) {
+            child->directory[l] = leaf_copy_cow(pool, leaf);
+        } else {
+            PageTableLeaf *copy = malloc(sizeof(PageTableLeaf));
+            *copy = *leaf;
+            copy->refcount = 1;
+            for (int i = 0; i < COW_LEAF_ENTRIES; i++) {
+                if (!copy->entries[i].presence_bit) continue;
+                int frame = frame_pool_alloc(pool);
+                memcpy(pool_frame_data(pool, frame), pool_frame_data(pool, leaf->entries[i].page_frame), PAGE_SIZE);
+                copy->entries[i].page_frame = frame;
+                pool->frame_copies++;
+            }
+            child->directory[l] = copy;
+        }
+    }
+    return child;
+}
+
+/**
+ * Función: address_space_write
+ * Descripción: Escribe en una página. Si la tabla hoja está compartida se copia
+ *              primero; si la página es de copia en escritura y su marco tiene
+ *              otras referencias se copia el marco, y si ya es la única
+ *              referencia basta con volver a permitir la escritura.
+ */
+void address_space_write(AddressSpace *as, int page_number, uint64_t value) {
+    FramePool *pool = as->pool;
+    PageTableLeaf **slot = &as->directory[page_number / COW_LEAF_ENTRIES];
+    if ((*slot)->refcount > 1) {
+        (*slot)->refcount--;
+        *slot = leaf_copy_cow(pool, *slot);
+        as->leaf_copies++;
+    }
+
+    PageTableEntry *entry = &(*slot)->entries[page_number % COW_LEAF_ENTRIES];
+    if (entry->cow_bit) {
+        if (pool->refcount[entry->page_frame] > 1) {
+            int frame = frame_pool_alloc(pool);
+            memcpy(pool_frame_data(pool, frame), pool_frame_data(pool, entry->page_frame), PAGE_SIZE);
+            pool->refcount[entry->page_frame]--;
+            entry->page_frame = frame;
+            pool->frame_copies++;
+        }
+        entry->cow_bit = 0;
+    }
+    entry->modified_bit = 1;
+    memcpy(pool_frame_data(pool, entry->page_frame), &value, sizeof(value));
+}
+
+/**
+ * Función: address_space_destroy
+ * Descripción: Libera un espacio de direcciones: cada tabla hoja que deja de
+ *              estar compartida suelta la referencia de sus marcos.
+ */
+void address_space_destroy(AddressSpace *as) {
+    for (int l = 0; l < as->num_leaves; l++) {
+        PageTableLeaf *leaf = as->directory[l];
+        if (--leaf->refcount > 0) continue;
+        for (int i = 0; i < COW_LEAF_ENTRIES; i++) {
+            if (leaf->entries[i].presence_bit) frame_pool_put(as->pool, leaf->entries[i].page_frame);
+        }
+        free(leaf);
+    }
+    free(as->directory);
+    free(as);
+}
+
+/**
+ * Función: run_fork_comparison
+ * Descripción: Mide, para un proceso de num_pages páginas, la latencia de fork
+ *              y la memoria usada con copia completa, con copia en escritura y
+ *              tablas copiadas, y con copia en escritura y tablas bajo demanda.
+ *              Tras el fork el hijo escribe en una fracción de sus páginas
+ *              agrupada en regiones contiguas, como hace un hijo que trabaja
+ *              sobre parte de los datos del padre. El ahorro es la fracción de la
+ *              memoria del hijo que no ha hecho falta copiar.
+ * Parámetros:
+ *   - num_pages: páginas del espacio de direcciones del padre.
+ */
+void run_fork_comparison(int num_pages) {
+    const char *names[] = {"copia completa", "COW, tablas copiadas", "COW, tablas bajo demanda"};
+    const double written_fraction = 0.10;
+    const int region = 64; // Páginas contiguas que escribe el hijo en cada región
+
+    printf("fork de un proceso de %d páginas (%d MB), el hijo escribe en el %.0f%% de ellas\n",
+           num_pages, (int)((long)num_pages * PAGE_SIZE >> 20), 100 * written_fraction);
+    printf("%-26s %12s %14s %16s %14s %14s\n", "modo", "fork (us)", "tablas hoja", "escrituras (ms)",
+           "marcos usados", "ahorro hijo");
+    for (int mode = FORK_FULL_COPY; mode <= FORK_COW_ON_DEMAND; mode++) {
+        FramePool *pool = frame_pool_create(2 * num_pages);
+        AddressSpace *parent = address_space_create(pool, num_pages);
+        int parent_leaves = parent->num_leaves;
+
+        double start = now_seconds();
+        AddressSpace *child = address_space_fork(parent, mode);
+        double fork_us = (now_seconds() - start) * 1e6;
+        long leaves_after_fork = mode == FORK_COW_ON_DEMAND ? parent_leaves : 2L * parent_leaves;
+
+        uint64_t rng = 0x853C49E6748FEA9BULL;
+        long to_write = (long)(num_pages * written_fraction);
+        start = now_seconds();
+        for (long written = 0; written < to_write; written += region) {
+            int base = (int)(rng_next(&rng) % (num_pages - region));
+            for (int i = 0; i < region; i++) address_space_write(child, base + i, written + i);
+        }
+        double write_ms = (now_seconds() - start) * 1e3;
+
+        int frames_used = pool->num_frames - pool->num_free;
+        printf("%-26s %12.1f %6ld -> %5ld %16.2f %14d %13.1f%%\n", names[mode], fork_us, leaves_after_fork,
+               leaves_after_fork + child->leaf_copies, write_ms, frames_used,
+               100.0 * (2.0 * num_pages - frames_used) / num_pages);
+
+        address_space_destroy(child);
+        address_space_destroy(parent);
+        frame_pool_destroy(pool);
+    }
+}
+
+/**
+ * Función: run_zero_page_comparison
+ * Descripción: Ejecuta la misma carga sin y con el marco cero compartido. La
+ *              carga recorre una reserva grande de la que sólo se escribe una de
+ *              cada cuatro páginas, como hacen los servicios con búferes
+ *              dimensionados para el peor caso. Informa de
+ *              los marcos ahorrados, los fallos y escrituras a swap evitados y
+ *              de la memoria residente real.
+ * Parámetros:
+ *   - num_accesses: número de accesos por ejecución.
+ */
+void run_zero_page_comparison(long num_accesses) {
+    PagingSystem *sys = malloc(sizeof(PagingSystem));
+    PagingStats results[2];
+    int zero_mapped[2];
+
+    printf("Páginas de demanda cero: %ld accesos sobre una reserva de 4096 páginas, %d marcos\n",
+           num_accesses, NUM_FRAMES);
+    for (int zero = 0; zero <= 1; zero++) {
+        paging_init(sys, 0);
+        if (zero) paging_enable_zero_page(sys);
+        Process *proc = process_create(1, 4096);
+        Workload w = workload_phased(0xBF58476D1CE4E5B9ULL, proc->num_pages, 300, 0.85, 0.2, num_accesses, 4);
+
+        for (long i = 0; i < num_accesses; i++) {
+            int is_write;
+            uint32_t address = workload_next(&w, &is_write);
+            paging_access(sys, proc, address, is_write && (address >> 12) % 4 == 0);
+        }
+
+        zero_mapped[zero] = 0;
+        for (int page = 0; page < proc->num_pages; page++) {
+            if (proc->table[page].presence_bit && proc->table[page].page_frame == sys->zero_frame) zero_mapped[zero]++;
+        }
+        results[zero] = sys->stats;
+        PagingStats *st = &sys->stats;
+        printf("\n%s:\n", zero ? "Con marco cero compartido" : "Sin marco cero (cada primer acceso asigna marco)");
+        printf(" - Fallos: %ld (%ld desde swap), escrituras en swap: %ld\n", st->faults, st->major_faults, st->swap_writes);
+        if (zero) {
+            printf(" - Lecturas resueltas con el marco cero: %ld, primeras escrituras que lo sustituyen: %ld\n",
+                   st->zero_page_maps, st->zero_page_breaks);
+        }
+        printf(" - Páginas proyectadas: %d, marcos residentes: %d\n",
+               proc->resident_pages + zero_mapped[zero], proc->resident_pages);
+        printf(" - AMAT: %.2f ns\n", st->access_time_ns / st->accesses);
+        process_destroy(proc);
+        paging_destroy(sys);
+    }
+
+    printf("\nMarcos ahorrados ahora mismo: %d; fallos desde swap evitados: %ld; escrituras en swap evitadas: %ld\n",
+           zero_mapped[1], results[0].major_faults - results[1].major_faults,
+           results[0].swap_writes - results[1].swap_writes);
+    free(sys);
+}
+
+/* ------------------------------------------------------------------------
+ * Fusión de páginas idénticas (estilo KSM)
+ * ------------------------------------------------------------------------
+ * Un hilo recorre los marcos residentes por lotes de KSM_PAGES_TO_SCAN y
+ * duerme KSM_SLEEP_US entre lotes, lo que acota su consumo de CPU. Cada página
+ * se resume con un hash SIMD; las páginas cuyo hash cambió desde la pasada
+ * anterior se consideran volátiles y no se fusionan. Si otra página con el
+ * mismo hash tiene el mismo contenido, ambas pasan a compartir un marco de
+ * sólo lectura (cow_bit) sin propietario, que el reloj no desaloja; la
+ * primera escritura en una de ellas vuelve a darle un marco propio.
+ */
+
+#define KSM_PAGES_TO_SCAN 64        // Marcos examinados por lote
+#define KSM_SLEEP_US 1000           // Pausa entre lotes en microsegundos
+#define KSM_TABLE_SIZE (2 * NUM_FRAMES) // Tabla hash de candidatos (direccionamiento abierto)
+
+static const uint32_t page_hash_primes[8] = {
+    0x9E3779B1u, 0x85EBCA77u, 0xC2B2AE3Du, 0x27D4EB2Fu,
+    0x165667B1u, 0xD3A2646Cu, 0xFD7046C5u, 0xB55A4F09u
+};
+
+// Mezcla final de los 8 carriles de 32 bits
+static uint32_t page_hash_finish(const uint32_t lanes[8]) {
+    uint32_t h = 0x811C9DC5u;
+    for (int i = 0; i < 8; i++) {
+        h ^= lanes[i];
+        h *= 0x01000193u;
+        h ^= h >> 15;
+    }
+    return h;
+}
+
+/**
+ * Función: page_hash_scalar
+ * Descripción: Hash de una página con 8 carriles independientes de 32 bits:
+ *              cada carril acumula una palabra de cada bloque de 32 bytes.
+ *              Produce el mismo valor que la versión AVX2.
+ */
+static uint32_t page_hash_scalar(const uint8_t *page) {
+    uint32_t lanes[8];
+    for (int i = 0; i < 8; i++) lanes[i] = page_hash_primes[i];
+    for (int offset = 0; offset < PAGE_SIZE; offset += 32) {
+        for (int i = 0; i < 8; i++) {
+            uint32_t word;
+            memcpy(&word, page + offset + 4 * i, sizeof(word));
+            uint32_t acc = lanes[i] + word * 0x85EBCA77u;
+            lanes[i] = ((acc << 13) | (acc >> 19)) * 0x9E3779B1u;
+        }
+    }
+    return page_hash_finish(lanes);
+}
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+/**
+ * Función: page_hash_avx2
+ * Descripción: Misma función que page_hash_scalar, procesando los 8 carriles a
+ *              la vez con registros AVX2 de 256 bits.
+ */
+__attribute__((target("avx2")))
+static uint32_t page_hash_avx2(const uint8_t *page) {
+    __m256i lanes = _mm256_loadu_si256((const __m256i *)page_hash_primes);
+    const __m256i prime_in = _mm256_set1_epi32((int)0x85EBCA77u);
+    const __m256i prime_out = _mm256_set1_epi32((int)0x9E3779B1u);
+    for (int offset = 0; offset < PAGE_SIZE; offset += 32) {
+        __m256i words = _mm256_loadu_si256((const __m256i *)(page + offset));
+        __m256i acc = _mm256_add_epi32(lanes, _mm256_mullo_epi32(words, prime_in));
+        acc = _mm256_or_si256(_mm256_slli_epi32(acc, 13), _mm256_srli_epi32(acc, 19));
+        lanes = _mm256_mullo_epi32(acc, prime_out);
+    }
+    uint32_t out[8];
+    _mm256_storeu_si256((__m256i *)out, lanes);
+    return page_hash_finish(out);
+}
+#endif
+
+/**
+ * Función: page_hash
+ * Descripción: Hash del contenido de una página; usa AVX2 si la CPU lo admite.
+ */
+uint32_t page_hash(const uint8_t *page) {
+#if defined(__x86_64__)
+    static int use_avx2 = -1;
+    if (use_avx2 == -1) use_avx2 = __builtin_cpu_supports("avx2");
+    if (use_avx2) return page_hash_avx2(page);
+#endif
+    return page_hash_scalar(page);
+}
+
+// Estado del hilo de fusión
+typedef struct {
+    PagingSystem *sys;
+    int stop;               // Petición de parada (protegida por sys->lock)
+    int table[KSM_TABLE_SIZE]; // Candidatos de la pasada actual: marco o -1
+    long full_scans;        // Pasadas completas sobre la memoria física
+    long pages_scanned;
+    long merges;            // Páginas fusionadas con otra
+    double cpu_seconds;     // Tiempo de CPU consumido por el hilo
+    pthread_t thread;
+} KsmScanner;
+
+/**
+ * Función: ksm_merge_into
+ * Descripción: Hace que la página alojada en 'frame' comparta el marco 'target',
+ *              que tiene el mismo contenido. Si target aún tenía propietario se
+ *              convierte primero en marco compartido.
+ */
+static void ksm_merge_into(PagingSystem *sys, int frame, int target) {
+    FrameInfo *info = &sys->frames[frame], *shared = &sys->frames[target];
+    if (!shared->ksm) {
+        PageTableEntry *owner_entry = &shared->owner->table[shared->page_number];
+        owner_entry->cow_bit = 1;
+        shared->owner->resident_pages--;
+        shared->owner = NULL;
+        shared->page_number = -1;
+        shared->ksm = 1;
+        shared->sharers = 1;
+    }
+
+    PageTableEntry *entry = &info->owner->table[info->page_number];
+    entry->page_frame = target;
+    entry->cow_bit = 1;
+    shared->sharers++;
+    info->owner->resident_pages--;
+    info->owner = NULL;
+    info->page_number = -1;
+    sys->free_frames[sys->num_free++] = frame;
+}
+
+/**
+ * Función: ksm_scan_frame
+ * Descripción: Examina un marco: actualiza su hash y, si es estable, lo busca
+ *              en la tabla de candidatos para fusionarlo o lo inserta en ella.
+ *              Se llama con sys->lock tomado.
+ */
+static void ksm_scan_frame(KsmScanner *ksm, int frame) {
+    PagingSystem *sys = ksm->sys;
+    FrameInfo *info = &sys->frames[frame];
+    if (frame == sys->zero_frame || (info->owner == NULL && !info->ksm)) return; // Libre o reservado
+
+    uint8_t *data = frame_data(sys, frame);
+    uint32_t hash = page_hash(data);
+    ksm->pages_scanned++;
+    if (!info->ksm && hash != info->checksum) {
+        info->checksum = hash; // Página volátil: se reconsiderará en la siguiente pasada
+        return;
+    }
+
+    for (int probe = 0; probe < KSM_TABLE_SIZE; probe++) {
+        int pos = (hash + probe) % KSM_TABLE_SIZE;
+        int candidate = ksm->table[pos];
+        if (candidate == -1) {
+            ksm->table[pos] = frame;
+            return;
+        }
+        if (candidate == frame) return;
+        FrameInfo *other = &sys->frames[candidate];
+        // El candidato pudo liberarse o cambiar desde que se insertó
+        if ((other->owner == NULL && !other->ksm) || other->checksum != hash) continue;
+        if (memcmp(frame_data(sys, candidate), data, PAGE_SIZE) != 0) continue;
+
+        if (info->ksm && !other->ksm) {
+            // Se conserva el marco ya compartido y se fusiona el candidato en él
+            ksm_merge_into(sys, candidate, frame);
+            ksm->table[pos] = frame;
+        } else if (!info->ksm) {
+            ksm_merge_into(sys, frame, candidate);
+        } else {
+            continue; // Dos marcos ya compartidos: se dejan como están
+        }
+        ksm->merges++;
+        return;
+    }
+}
+
+static void *ksm_thread(void *arg) {
+    KsmScanner *ksm = arg;
+    PagingSystem *sys = ksm->sys;
+    struct timespec pause = {0, KSM_SLEEP_US * 1000L};
+    int next = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&sys->lock);
+        if (ksm->stop) {
+            pthread_mutex_unlock(&sys->lock);
+            break;
+        }
+        for (int i = 0; i < KSM_PAGES_TO_SCAN; i++) {
+            if (next == 0) {
+                memset(ksm->table, -1, sizeof(ksm->table));
+                ksm->full_scans++;
+            }
+            ksm_scan_frame(ksm, next);
+            next = (next + 1) % NUM_FRAMES;
+        }
+        pthread_mutex_unlock(&sys->lock);
+        nanosleep(&pause, NULL);
+    }
+
+    struct timespec cpu;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+    ksm->cpu_seconds = cpu.tv_sec + cpu.tv_nsec / 1e9;
+    return NULL;
+}
+
+/**
+ * Función: ksm_start
+ * Descripción: Arranca el hilo de fusión sobre un simulador. Desde ese momento
+ *              paging_access toma el cerrojo del simulador.
+ */
+KsmScanner *ksm_start(PagingSystem *sys) {
+    KsmScanner *ksm = calloc(1, sizeof(KsmScanner));
+    ksm->sys = sys;
+    sys->background_threads++;
+    pthread_create(&ksm->thread, NULL, ksm_thread, ksm);
+    return ksm;
+}
+
+/**
+ * Función: ksm_stop
+ * Descripción: Detiene el hilo de fusión. El estado queda disponible para
+ *              consultar sus estadísticas hasta liberarlo con free.
+ */
+void ksm_stop(KsmScanner *ksm) {
+    pthread_mutex_lock(&ksm->sys->lock);
+    ksm->stop = 1;
+    pthread_mutex_unlock(&ksm->sys->lock);
+    pthread_join(ksm->thread, NULL);
+    ksm->sys->background_threads--;
+}
+
+/**
+ * Función: ksm_count_shared
+ * Descripción: Cuenta los marcos compartidos y las páginas que los usan.
+ */
+static void ksm_count_shared(PagingSystem *sys, int *pages_shared, int *pages_sharing) {
+    *pages_shared = *pages_sharing = 0;
+    for (int f = 0; f < NUM_FRAMES; f++) {
+        if (!sys->frames[f].ksm) continue;
+        (*pages_shared)++;
+        *pages_sharing += sys->frames[f].sharers;
+    }
+}
+
+/**
+ * Función: run_ksm_comparison
+ * Descripción: Simula un anfitrión con varias máquinas virtuales que comparten
+ *              parte de su imagen (mismas páginas de sistema) y ejecuta la carga
+ *              sin y con el hilo de fusión. Informa de la memoria ahorrada, del
+ *              coste de CPU del escaneo y del efecto sobre los fallos.
+ * Parámetros:
+ *   - num_accesses: accesos totales repartidos entre las máquinas virtuales.
+ */
+void run_ksm_comparison(long num_accesses) {
+    // Las máquinas caben juntas en los marcos: si la carga hiperpagina, los marcos se
+    // reutilizan antes de la segunda pasada del escáner y ninguna página llega a ser estable
+    const int num_vms = 4, vm_pages = 112, image_pages = 64;
+    PagingSystem *sys = malloc(sizeof(PagingSystem));
+    Process *vms[4];
+    Workload loads[4];
+
+    printf("Fusión de páginas: %d máquinas virtuales de %d páginas (%d de imagen común), %d marcos\n",
+           num_vms, vm_pages, image_pages, NUM_FRAMES);
+    printf("Escaneo limitado a %d páginas cada %d µs\n", KSM_PAGES_TO_SCAN, KSM_SLEEP_US);
+    for (int use_ksm = 0; use_ksm <= 1; use_ksm++) {
+        paging_init(sys, 0);
+        for (int v = 0; v < num_vms; v++) {
+            vms[v] = process_create(v + 1, vm_pages);
+            vms[v]->image_pages = image_pages;
+            loads[v] = (Workload){0x94D049BB133111EBULL * (v + 1), vm_pages, 96, 0.8, 0.02, num_accesses, 0};
+        }
+        KsmScanner *ksm = use_ksm ? ksm_start(sys) : NULL;
+
+        double start = now_seconds();
+        for (long i = 0; i < num_accesses; i++) {
+            int v = i % num_vms, is_write;
+            uint32_t address = workload_next(&loads[v], &is_write);
+            // Las páginas de la imagen común son de sólo lectura (código y datos del sistema)
+            if ((int)(address >> 12) < image_pages) is_write = 0;
+            paging_access(sys, vms[v], address, is_write);
+        }
+        double elapsed = now_seconds() - start;
+        if (ksm) ksm_stop(ksm);
+
+        int pages_shared, pages_sharing, resident = 0;
+        ksm_count_shared(sys, &pages_shared, &pages_sharing);
+        for (int v = 0; v < num_vms; v++) resident += vms[v]->resident_pages;
+        PagingStats *st = &sys->stats;
+        printf("\n%s:\n", use_ksm ? "Con fusión de páginas" : "Sin fusión de páginas");
+        printf(" - Fallos: %ld (%ld desde swap), AMAT: %.2f ns\n", st->faults, st->major_faults,
+               st->access_time_ns / st->accesses);
+        printf(" - Marcos propios: %d, marcos compartidos: %d usados por %d páginas\n",
+               resident, pages_shared, pages_sharing);
+        printf(" - Fusiones: %ld\n", ksm ? ksm->merges : 0L);
+        if (ksm) {
+            printf(" - Memoria ahorrada: %d marcos (%d KB), roturas por escritura: %ld\n",
+                   pages_sharing - pages_shared, (pages_sharing - pages_shared) * PAGE_SIZE / 1024,
+                   st->ksm_cow_breaks);
+            if (ksm->merges == 0) {
+                printf(" - Ninguna página se fusionó: el escáner no vio ninguna página estable en dos pasadas\n");
+            }
+            printf(" - Escaneo: %ld pasadas, %ld páginas, %.1f ms de CPU (%.1f%% del tiempo de ejecución)\n",
+                   ksm->full_scans, ksm->pages_scanned, ksm->cpu_seconds * 1e3,
+                   100.0 * ksm->cpu_seconds / elapsed);
+            free(ksm);
+        }
+        for (int v = 0; v < num_vms; v++) process_destroy(vms[v]);
+        paging_destroy(sys);
+    }
+    free(sys);
+}
+
+/* ------------------------------------------------------------------------
+ * Memoria física real y reproducción de trazas de cargas y almacenamientos
+ * ------------------------------------------------------------------------
+ * Los 2^PHYSICAL_ADDRESS_BITS bytes de memoria física se respaldan con una
+ * proyección anónima del anfitrión, de modo que las direcciones que devuelve
+ * get_physical_address se pueden leer y escribir con datos reales. La
+ * reproducción rápida traduce con una copia plana de la tabla de páginas
+ * (página -> base física) para no pagar la validación ni los mensajes de
+ * get_physical_address en cada registro.
+ */
+
+// Registro de una traza: carga o almacenamiento de 8 bytes
+typedef struct {
+    uint32_t virtual_address;
+    uint32_t is_store;      // 1 = almacenamiento de value, 0 = carga
+    uint64_t value;
+} TraceRecord;
+
+// Resultado de una reproducción
+typedef struct {
+    long loads;
+    long stores;
+    long faults;            // Registros sobre páginas ausentes (no se aplican)
+    uint64_t checksum;      // XOR de los valores cargados
+} ReplayStats;
+
+static uint8_t *physical_memory = NULL; // Memoria física de la tabla de páginas del enunciado
+
+/**
+ * Función: physical_read64 / physical_write64
+ * Descripción: Acceso de 8 bytes a una dirección física devuelta por
+ *              get_physical_address.
+ */
+uint64_t physical_read64(int physical_address) {
+    uint64_t value;
+    memcpy(&value, physical_memory + physical_address, sizeof(value));
+    return value;
+}
+
+void physical_write64(int physical_address, uint64_t value) {
+    memcpy(physical_memory + physical_address, &value, sizeof(value));
+}
+
+/**
+ * Función: generate_trace
+ * Descripción: Genera una traza sintética: ráfagas secuenciales de 8 bytes
+ *              sobre páginas elegidas al azar entre las num_pages primeras, con
+ *              una fracción de almacenamientos.
+ */
+TraceRecord *generate_trace(long num_records, int num_pages, double store_fraction, uint64_t seed) {
+    TraceRecord *trace = malloc(num_records * sizeof(TraceRecord));
+    uint32_t address = 0;
+    for (long i = 0; i < num_records; i++) {
+        if (i % 64 == 0) {
+            address = (uint32_t)(rng_next(&seed) % num_pages) << 12 | (uint32_t)(rng_next(&seed) & (PAGE_SIZE - 1) & ~63u);
+        }
+        trace[i].virtual_address = address;
+        trace[i].is_store = rng_uniform(&seed) < store_fraction;
+        trace[i].value = rng_next(&seed);
+        address = (address & ~(uint32_t)(PAGE_SIZE - 1)) | ((address + 8) & (PAGE_SIZE - 8));
+    }
+    return trace;
+}
+
+/**
+ * Función: replay_trace
+ * Descripción: Aplica una traza sobre la memoria física de la tabla de páginas
+ *              del enunciado. La tabla se copia antes a un vector plano de
+ *              bases físicas, así el bucle interno es una indexación y un
+ *              acceso a memoria por registro.
+ */
+ReplayStats replay_trace(const TraceRecord *trace, long num_records) {
+    const int num_entries = sizeof(page_table) / sizeof(PageTableEntry);
+    int32_t frame_base[256];
+    ReplayStats stats = {0, 0, 0, 0};
+
+    for (int page = 0; page < 256; page++) {
+        frame_base[page] = page < num_entries && page_table[page].presence_bit
+                           ? page_table[page].page_frame * PAGE_SIZE : -1;
+    }
+    for (long i = 0; i < num_records; i++) {
+        const TraceRecord *r = &trace[i];
+        int32_t base = frame_base[(r->virtual_address >> 12) & 0xFF];
+        if (base < 0) {
+            stats.faults++;
+            continue;
+        }
+        uint8_t *location = physical_memory + base + (r->virtual_address & (PAGE_SIZE - 8));
+        if (r->is_store) {
+            memcpy(location, &r->value, sizeof(r->value));
+            stats.stores++;
+        } else {
+            uint64_t value;
+            memcpy(&value, location, sizeof(value));
+            stats.checksum ^= value;
+            stats.loads++;
+        }
+    }
+    return stats;
+}
+
+/**
+ * Función: validate_paging_contents
+ * Descripción: Reproduce una traza a través del simulador de paginación con la
+ *              caché comprimida y el marco cero activos y una memoria mucho
+ *              menor que el proceso, de modo que las páginas pasan por
+ *              compresión, swap y vuelta. Cada carga se compara con el último
+ *              valor almacenado en esa dirección; en las páginas cuyo primer
+ *              acceso fue una lectura (demanda cero), las posiciones nunca
+ *              escritas deben seguir leyéndose como cero, también después de
+ *              la primera escritura en la página.
+ * Retorno:
+ *   - Número de cargas con un valor distinto del esperado.
+ */
+long validate_paging_contents(const TraceRecord *trace, long num_records, int num_pages) {
+    PagingSystem *sys = malloc(sizeof(PagingSystem));
+    Process *proc = process_create(1, num_pages);
+    long slots = (long)num_pages * (PAGE_SIZE / 8);
+    uint64_t *expected = malloc(slots * sizeof(uint64_t));
+    uint8_t *written = calloc(slots, 1);
+    uint8_t *first_read = calloc(num_pages, 1);  // 1 si el primer acceso a la página fue una lectura
+    uint8_t *touched = calloc(num_pages, 1);
+    long mismatches = 0, checked = 0, zero_checked = 0;
+
+    paging_init(sys, 1);
+    paging_enable_zero_page(sys);
+    for (long i = 0; i < num_records; i++) {
+        const TraceRecord *r = &trace[i];
+        long slot = r->virtual_address >> 3;
+        int page = r->virtual_address >> 12;
+        if (!touched[page]) {
+            touched[page] = 1;
+            first_read[page] = !r->is_store;
+        }
+        int physical_address = paging_access(sys, proc, r->virtual_address & ~7u, r->is_store);
+        uint8_t *location = sys->memory + physical_address;
+        if (r->is_store) {
+            memcpy(location, &r->value, sizeof(r->value));
+            expected[slot] = r->value;
+            written[slot] = 1;
+        } else if (written[slot]) {
+            uint64_t value;
+            memcpy(&value, location, sizeof(value));
+            if (value != expected[slot]) mismatches++;
+            checked++;
+        } else if (first_read[page]) {
+            uint64_t value;
+            memcpy(&value, location, sizeof(value));
+            if (value != 0) mismatches++;
+            zero_checked++;
+        }
+    }
+    printf(" - Validación de contenidos: %ld cargas comprobadas (%ld de posiciones de demanda cero), %ld incorrectas "
+           "(%ld fallos, %ld desde la caché comprimida, %ld desde swap)\n",
+           checked + zero_checked, zero_checked, mismatches, sys->stats.faults, sys->stats.zswap_loads,
+           sys->stats.major_faults);
+
+    free(expected);
+    free(written);
+    free(first_read);
+    free(touched);
+    process_destroy(proc);
+    paging_destroy(sys);
+    free(sys);
+    return mismatches;
+}
+
+/**
+ * Función: run_trace_replay
+ * Descripción: Reproduce una traza de cargas y almacenamientos sobre la memoria
+ *              física proyectada, comprueba una muestra contra
+ *              get_physical_address e informa del ancho de banda alcanzado
+ *              frente al de memcpy sobre el mismo búfer. Después valida los
+ *              contenidos de extremo a extremo a través del simulador.
+ * Parámetros:
+ *   - path: fichero con registros TraceRecord, o NULL para una traza sintética.
+ *   - num_records: registros de la traza sintética.
+ * Retorno:
+ *   - 0 si la traza se reprodujo, 1 si no se pudo leer o reservar.
+ */
+int run_trace_replay(const char *path, long num_records) {
+    TraceRecord *trace;
+    const size_t memory_size = (size_t)1 << PHYSICAL_ADDRESS_BITS;
+
+    if (path) {
+        FILE *file = fopen(path, "rb");
+        if (file == NULL) {
+            perror(path);
+            return 1;
+        }
+        // Un directorio se abre sin error, pero su tamaño no es el de una traza
+        struct stat info;
+        if (fstat(fileno(file), &info) != 0 || !S_ISREG(info.st_mode)) {
+            fprintf(stderr, "%s no es un fichero de traza legible\n", path);
+            fclose(file);
+            return 1;
+        }
+        num_records = info.st_size / (long)sizeof(TraceRecord);
+        if (num_records <= 0) {
+            fprintf(stderr, "La traza %s no contiene registros completos\n", path);
+            fclose(file);
+            return 1;
+        }
+        trace = malloc(num_records * sizeof(TraceRecord));
+        if (trace == NULL) {
+            fprintf(stderr, "No hay memoria para %ld registros de traza\n", num_records);
+            fclose(file);
+            return 1;
+        }
+        long read = fread(trace, sizeof(TraceRecord), num_records, file);
+        fclose(file);
+        if (read != num_records) {
+            fprintf(stderr, "Lectura incompleta de la traza %s: %ld de %ld registros\n", path, read, num_records);
+            free(trace);
+            return 1;
+        }
+    } else {
+        trace = generate_trace(num_records, sizeof(page_table) / sizeof(PageTableEntry), 0.3, 0x5851F42D4C957F2DULL);
+        if (trace == NULL) {
+            fprintf(stderr, "No hay memoria para %ld registros de traza\n", num_records);
+            return 1;
+        }
+    }
+    physical_memory = map_physical_memory(memory_size);
+
+    // Muestra de comprobación: la ruta rápida debe coincidir con get_physical_address
+    for (long i = 0; i < num_records && i < 64; i++) {
+        int page = (trace[i].virtual_address >> 12) & 0xFF;
+        if (page < (int)(sizeof(page_table) / sizeof(PageTableEntry)) && page_table[page].presence_bit) {
+            int physical_address = get_physical_address(trace[i].virtual_address & ~7u);
+            physical_write64(physical_address, trace[i].value);
+            if (physical_read64(physical_address) != trace[i].value) printf("Lectura incorrecta en 0x%X\n", physical_address);
+        }
+    }
+
+    double start = now_seconds();
+    ReplayStats stats = replay_trace(trace, num_records);
+    double elapsed = now_seconds() - start;
+
+    uint8_t *copy = malloc(memory_size);
+    start = now_seconds();
+    for (int i = 0; i < 16; i++) {
+        memcpy(copy, physical_memory, memory_size);
+        __asm__ volatile("" : : "r"(copy) : "memory"); // Evita que se elimine la copia
+    }
+    double memcpy_gbs = 16.0 * 2 * memory_size / (now_seconds() - start) / 1e9;
+    free(copy);
+
+    long applied = stats.loads + stats.stores;
+    printf("Reproducción de %ld registros sobre %zu KB de memoria física proyectada\n", num_records, memory_size / 1024);
+    printf(" - Cargas: %ld, almacenamientos: %ld, registros sobre páginas en swap: %ld (suma 0x%llx)\n",
+           stats.loads, stats.stores, stats.faults, (unsigned long long)stats.checksum);
+    printf(" - %.1f M registros/s, %.2f GB/s de traza + datos (memcpy del anfitrión: %.2f GB/s)\n",
+           num_records / elapsed / 1e6, (num_records * sizeof(TraceRecord) + applied * 8.0) / elapsed / 1e9, memcpy_gbs);
+
+    if (path == NULL) {
+        TraceRecord *paged = generate_trace(num_records < 2000000 ? num_records : 2000000, 2048, 0.4, 0x14057B7EF767814FULL);
+        validate_paging_contents(paged, num_records < 2000000 ? num_records : 2000000, 2048);
+        free(paged);
+    }
+    munmap(physical_memory, memory_size);
+    physical_memory = NULL;
+    free(trace);
+    return 0;
+}
+
+/* ------------------------------------------------------------------------
+ * Paginación por demanda real con userfaultfd (solo Linux)
+ * ------------------------------------------------------------------------
+ * Una región de memoria del anfitrión se registra con userfaultfd: cada
+ * primer acceso a una de sus páginas detiene al hilo que accede y envía un
+ * mensaje al descriptor. Los hilos manejadores atienden esos fallos con el
+ * simulador: el acceso a la página en el simulador la trae de la caché
+ * comprimida, del fichero de swap o la genera, y su contenido se instala en
+ * la región con UFFDIO_COPY. Así se mide el coste real de un fallo atendido
+ * en espacio de usuario y se compara con el coste que modela el simulador.
+ */
+
+#define UFFD_PAGES 4096        // Páginas de la región registrada (16MB)
+#define UFFD_MAX_THREADS 16    // Máximo de hilos manejadores
+
+#if defined(__linux__)
+#include <linux/userfaultfd.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <errno.h>
+
+// Estado compartido por los hilos manejadores y los que provocan los fallos
+typedef struct {
+    PagingSystem *sys;
+    Process *proc;
+    int uffd;
+    uint8_t *region;
+    atomic_int stop;
+    atomic_long served;
+    long service_ns[3];        // Tiempo de servicio por origen: 0 = residente en el simulador, 1 = caché comprimida, 2 = swap
+    long service_count[3];
+} UffdHarness;
+
+// Hilo que recorre una parte de la región, de las páginas más recientes a las más antiguas,
+// y mide la latencia de cada primer acceso
+typedef struct {
+    UffdHarness *harness;
+    int first_page, step;       // Páginas UFFD_PAGES - 1 - first_page, - step, ...
+    long latency_ns;           // Suma de latencias de los fallos del hilo
+    long faults;
+    uint64_t checksum;         // Suma de un byte de cada página para que las lecturas no se eliminen
+} UffdToucher;
+
+/**
+ * Función: uffd_handler_thread
+ * Descripción: Espera mensajes de fallo en el descriptor userfaultfd y los
+ *              atiende. El simulador se consulta con su cerrojo, copiando la
+ *              página a un búfer propio; la instalación con UFFDIO_COPY se
+ *              hace fuera del cerrojo para que varios manejadores trabajen a
+ *              la vez en el núcleo.
+ */
+static void *uffd_handler_thread(void *arg) {
+    UffdHarness *h = arg;
+    uint8_t *buffer = aligned_alloc(PAGE_SIZE, PAGE_SIZE);
+    struct pollfd pfd = {.fd = h->uffd, .events = POLLIN};
+
+    while (!atomic_load(&h->stop)) {
+        struct uffd_msg msg;
+        if (poll(&pfd, 1, 10) <= 0) continue;
+        if (read(h->uffd, &msg, sizeof(msg)) != sizeof(msg)) continue; // Otro manejador se llevó el mensaje
+        if (msg.event != UFFD_EVENT_PAGEFAULT) continue;
+
+        double start = now_seconds();
+        uint64_t address = msg.arg.pagefault.address & ~(uint64_t)(PAGE_SIZE - 1);
+        int page_number = (address - (uint64_t)(uintptr_t)h->region) / PAGE_SIZE;
+
+        pthread_mutex_lock(&h->sys->lock);
+        long zswap_loads = h->sys->stats.zswap_loads, major_faults = h->sys->stats.major_faults;
+        int physical_address = paging_access_unlocked(h->sys, h->proc, (uint32_t)page_number << 12, 0);
+        memcpy(buffer, h->sys->memory + (physical_address & ~(PAGE_SIZE - 1)), PAGE_SIZE);
+        int source = h->sys->stats.major_faults != major_faults ? 2 : h->sys->stats.zswap_loads != zswap_loads ? 1 : 0;
+        pthread_mutex_unlock(&h->sys->lock);
+
+        struct uffdio_copy copy = {.dst = address, .src = (uint64_t)(uintptr_t)buffer, .len = PAGE_SIZE, .mode = 0};
+        if (ioctl(h->uffd, UFFDIO_COPY, &copy) != 0 && errno != EEXIST) {
+            perror("UFFDIO_COPY");
+        }
+
+        pthread_mutex_lock(&h->sys->lock);
+        h->service_ns[source] += (long)((now_seconds() - start) * 1e9);
+        h->service_count[source]++;
+        pthread_mutex_unlock(&h->sys->lock);
+        atomic_fetch_add(&h->served, 1);
+    }
+    free(buffer);
+    return NULL;
+}
+
+static void *uffd_toucher_thread(void *arg) {
+    UffdToucher *t = arg;
+    for (int page = UFFD_PAGES - 1 - t->first_page; page >= 0; page -= t->step) {
+        double start = now_seconds();
+        t->checksum += *(volatile uint8_t *)(t->harness->region + (size_t)page * PAGE_SIZE);
+        t->latency_ns += (long)((now_seconds() - start) * 1e9);
+        t->faults++;
+    }
+    return NULL;
+}
+
+/**
+ * Función: uffd_run
+ * Descripción: Una medición completa con num_handlers hilos manejadores y otros
+ *              tantos hilos que provocan los fallos. El simulador se prepara
+ *              leyendo todas las páginas, de modo que la mayoría acaban en la
+ *              caché comprimida o en swap; la región se recorre en orden inverso
+ *              para que los fallos reales encuentren primero las páginas
+ *              residentes, después las de la caché comprimida y al final las
+ *              del swap.
+ * Retorno:
+ *   - 0 si la medición se ha hecho, -1 si userfaultfd no está disponible.
+ */
+static int uffd_run(int num_handlers) {
+    UffdHarness h;
+    memset(&h, 0, sizeof(h));
+    h.uffd = syscall(__NR_userfaultfd, O_CLOEXEC | O_NONBLOCK);
+    if (h.uffd < 0) {
+        perror("userfaultfd no disponible");
+        printf("(puede requerir privilegios o vm.unprivileged_userfaultfd = 1)\n");
+        return -1;
+    }
+    struct uffdio_api api = {.api = UFFD_API, .features = 0};
+    if (ioctl(h.uffd, UFFDIO_API, &api) != 0) {
+        perror("UFFDIO_API");
+        close(h.uffd);
+        return -1;
+    }
+    h.region = mmap(NULL, (size_t)UFFD_PAGES * PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    struct uffdio_register reg = {.range = {.start = (uint64_t)(uintptr_t)h.region, .len = (uint64_t)UFFD_PAGES * PAGE_SIZE},
+                                  .mode = UFFDIO_REGISTER_MODE_MISSING};
+    if (h.region == MAP_FAILED) {
+        perror("mmap");
+        close(h.uffd);
+        return -1;
+    }
+    if (ioctl(h.uffd, UFFDIO_REGISTER, &reg) != 0) {
+        perror("UFFDIO_REGISTER");
+        munmap(h.region, (size_t)UFFD_PAGES * PAGE_SIZE);
+        close(h.uffd);
+        return -1;
+    }
+
+    h.sys = malloc(sizeof(PagingSystem));
+    h.proc = process_create(1, UFFD_PAGES);
+    paging_init(h.sys, 1);
+    for (int page = 0; page < UFFD_PAGES; page++) paging_access(h.sys, h.proc, (uint32_t)page << 12, 0);
+    PagingStats before = h.sys->stats;
+
+    pthread_t handlers[UFFD_MAX_THREADS], touchers[UFFD_MAX_THREADS];
+    UffdToucher t[UFFD_MAX_THREADS];
+    for (int i = 0; i < num_handlers; i++) pthread_create(&handlers[i], NULL, uffd_handler_thread, &h);
+    double start = now_seconds();
+    for (int i = 0; i < num_handlers; i++) {
+        t[i] = (UffdToucher){.harness = &h, .first_page = i, .step = num_handlers};
+        pthread_create(&touchers[i], NULL, uffd_toucher_thread, &t[i]);
+    }
+    long latency_ns = 0, faults = 0;
+    for (int i = 0; i < num_handlers; i++) {
+        pthread_join(touchers[i], NULL);
+        latency_ns += t[i].latency_ns;
+        faults += t[i].faults;
+    }
+    double elapsed = now_seconds() - start;
+    atomic_store(&h.stop, 1);
+    for (int i = 0; i < num_handlers; i++) pthread_join(handlers[i], NULL);
+
+    // Todas las lecturas del simulador son de páginas no escritas: deben coincidir con su contenido inicial
+    uint8_t *expected = malloc(PAGE_SIZE);
+    int mismatches = 0;
+    for (int page = 0; page < UFFD_PAGES; page++) {
+        fill_page_contents(expected, h.proc->pid, page);
+        if (memcmp(expected, h.region + (size_t)page * PAGE_SIZE, PAGE_SIZE) != 0) mismatches++;
+    }
+    free(expected);
+
+    // Coste modelado por el simulador para los mismos fallos
+    double modeled_ns = (h.sys->stats.access_time_ns - before.access_time_ns) / faults;
+    printf(" %8d %10.0f %12.1f %12.1f %12.1f %12.1f %12.1f %7d\n",
+           num_handlers, faults / elapsed, latency_ns / 1000.0 / faults,
+           h.service_count[0] ? h.service_ns[0] / 1000.0 / h.service_count[0] : 0.0,
+           h.service_count[1] ? h.service_ns[1] / 1000.0 / h.service_count[1] : 0.0,
+           h.service_count[2] ? h.service_ns[2] / 1000.0 / h.service_count[2] : 0.0,
+           modeled_ns / 1000.0, mismatches);
+
+    munmap(h.region, (size_t)UFFD_PAGES * PAGE_SIZE);
+    close(h.uffd);
+    process_destroy(h.proc);
+    paging_destroy(h.sys);
+    free(h.sys);
+    return 0;
+}
+
+/**
+ * Función: run_uffd_harness
+ * Descripción: Mide fallos de página reales atendidos con userfaultfd desde el
+ *              simulador con 1, 2, 4... hasta max_handlers hilos manejadores:
+ *              rendimiento, latencia vista por el hilo que falla, tiempo de
+ *              servicio según el origen de la página y coste modelado.
+ */
+void run_uffd_harness(int max_handlers) {
+    if (max_handlers < 1) max_handlers = 1;
+    if (max_handlers > UFFD_MAX_THREADS) max_handlers = UFFD_MAX_THREADS;
+    printf("Fallos reales con userfaultfd sobre %d páginas servidas por el simulador\n", UFFD_PAGES);
+    printf(" %8s %10s %12s %12s %12s %12s %12s %7s\n", "Hilos", "Fallos/s", "Latencia us",
+           "Residente us", "zswap us", "Swap us", "Modelo us", "Errores");
+    for (int handlers = 1; handlers <= max_handlers; handlers *= 2) {
+        if (uffd_run(handlers) != 0) return;
+    }
+    printf("El modelo suma PAGE_FAULT_TIME (%d ns) y SWAP_ACCESS_TIME (%d ns) si la página viene del swap;\n"
+           "el fichero de swap real suele estar en la caché de páginas del anfitrión.\n", PAGE_FAULT_TIME, SWAP_ACCESS_TIME);
+}
+#else
+void run_uffd_harness(int max_handlers) {
+    (void)max_handlers;
+    printf("userfaultfd solo está disponible en Linux\n");
+}
+#endif
+
+/* ------------------------------------------------------------------------
+ * Traducción por rangos
+ * ------------------------------------------------------------------------
+ * Muchas asignaciones quedan en marcos físicamente contiguos. Una entrada de
+ * rango [base, limit) con desplazamiento offset traduce todas esas páginas
+ * de una vez: marco = página + offset. La tabla de rangos se construye a
+ * partir de la tabla de páginas, se mantiene ordenada por base y se consulta
+ * con búsqueda binaria cuando falla el TLB de páginas; si el rango acierta,
+ * la página se traduce sin recorrer la tabla de páginas.
+ */
+
+#define RANGE_MIN_PAGES 2      // Las páginas sueltas se dejan a la tabla de páginas
+#define RANGE_TLB_ENTRIES 64   // Entradas del TLB de páginas del experimento
+#define RANGE_PAGES 16384      // Páginas del proceso sintético (64MB)
+#define PAGE_WALK_LEVELS 2     // Accesos a memoria de un recorrido de la tabla de páginas
+
+// Entrada de rango: páginas [base, limit) en los marcos [base + offset, limit + offset)
+typedef struct {
+    int base;
+    int limit;
+    int offset;
+} RangeEntry;
+
+typedef struct {
+    RangeEntry *entries;    // Ordenadas por base, sin solapes
+    int count;
+} RangeTable;
+
+/**
+ * Función: range_table_build
+ * Descripción: Recorre la tabla de páginas y agrupa las páginas presentes
+ *              consecutivas cuyos marcos también son consecutivos. Las
+ *              secuencias de al menos RANGE_MIN_PAGES páginas se convierten en
+ *              entradas de rango; como se recorren en orden, la tabla ya queda
+ *              ordenada.
+ */
+RangeTable range_table_build(const PageTableEntry *table, int num_pages) {
+    RangeTable rt = {malloc(num_pages * sizeof(RangeEntry)), 0};
+    int page = 0;
+    while (page < num_pages) {
+        if (!table[page].presence_bit) {
+            page++;
+            continue;
+        }
+        int start = page;
+        while (page + 1 < num_pages && table[page + 1].presence_bit &&
+               table[page + 1].page_frame == table[page].page_frame + 1) {
+            page++;
+        }
+        page++;
+        if (page - start >= RANGE_MIN_PAGES) {
+            rt.entries[rt.count++] = (RangeEntry){start, page, table[start].page_frame - start};
+        }
+    }
+    return rt;
+}
+
+/**
+ * Función: range_lookup
+ * Descripción: Búsqueda binaria del rango que contiene una página.
+ * Retorno:
+ *   - Entrada de rango, o NULL si la página no está cubierta por ningún rango.
+ */
+const RangeEntry *range_lookup(const RangeTable *rt, int page_number) {
+    int low = 0, high = rt->count - 1;
+    while (low <= high) {
+        int mid = (low + high) / 2;
+        if (page_number < rt->entries[mid].base) {
+            high = mid - 1;
+        } else if (page_number >= rt->entries[mid].limit) {
+            low = mid + 1;
+        } else {
+            return &rt->entries[mid];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Función: range_translate
+ * Descripción: Traduce una página con la tabla de rangos: marco = página + offset.
+ * Retorno:
+ *   - Marco de la página, o -1 si ningún rango la cubre.
+ */
+int range_translate(const RangeTable *rt, int page_number) {
+    const RangeEntry *range = range_lookup(rt, page_number);
+    return range ? page_number + range->offset : -1;
+}
+
+/**
+ * Función: get_physical_address_range
+ * Descripción: Como get_physical_address, pero consulta primero la tabla de
+ *              rangos y sólo recurre a la tabla de páginas si ningún rango
+ *              cubre la página.
+ * Parámetros:
+ *   - rt: tabla de rangos construida a partir de page_table.
+ *   - virtual_address: dirección virtual de 32 bits.
+ */
+int get_physical_address_range(const RangeTable *rt, uint32_t virtual_address) {
+    int frame = range_translate(rt, virtual_address >> 12); // Número de página completo: 20 bits
+    if (frame == -1) return get_physical_address(virtual_address);
+    return frame * PAGE_SIZE + (virtual_address & (PAGE_SIZE - 1));
+}
+
+// TLB de páginas totalmente asociativo con reemplazo LRU
+typedef struct {
+    int page[RANGE_TLB_ENTRIES];
+    long last_use[RANGE_TLB_ENTRIES];
+    long clock;
+} PageTlb;
+
+/**
+ * Función: page_tlb_access
+ * Descripción: Busca una página en el TLB; si falla la inserta en lugar de la
+ *              menos usada recientemente.
+ * Retorno:
+ *   - 1 si acierta, 0 si falla.
+ */
+static int page_tlb_access(PageTlb *tlb, int page_number) {
+    int victim = 0;
+    tlb->clock++;
+    for (int i = 0; i < RANGE_TLB_ENTRIES; i++) {
+        if (tlb->page[i] == page_number) {
+            tlb->last_use[i] = tlb->clock;
+            return 1;
+        }
+        if (tlb->last_use[i] < tlb->last_use[victim]) victim = i;
+    }
+    tlb->page[victim] = page_number;
+    tlb->last_use[victim] = tlb->clock;
+    return 0;
+}
+
+/**
+ * Función: build_extent_table
+ * Descripción: Construye la tabla de páginas de un proceso cuya memoria se ha
+ *              asignado por extensiones de 4 a 64 páginas: una fracción de
+ *              ellas ocupa marcos contiguos y el resto marcos sueltos; una
+ *              pequeña parte de las páginas está en swap.
+ */
+static void build_extent_table(PageTableEntry *table, int num_pages, double contiguous_fraction, uint64_t seed) {
+    int next_frame = 0, remaining = 0, scattered = 0;
+    for (int page = 0; page < num_pages; page++) {
+        int new_extent = remaining == 0;
+        if (new_extent) {
+            remaining = 4 << (rng_next(&seed) % 5);
+            scattered = rng_uniform(&seed) >= contiguous_fraction;
+        }
+        if (new_extent || scattered) {
+            next_frame += 1 + rng_next(&seed) % 8; // Hueco: la página no continúa la anterior
+        }
+        remaining--;
+        table[page] = (PageTableEntry){1, 0, next_frame++, 0, 0};
+        if (rng_uniform(&seed) < 0.02) {
+            table[page].presence_bit = 0;
+            table[page].page_frame = page;
+        }
+    }
+}
+
+/**
+ * Función: run_range_comparison
+ * Descripción: Traduce la misma secuencia de accesos con un TLB de páginas y
+ *              recorrido de la tabla en cada fallo, y con el mismo TLB más la
+ *              tabla de rangos. Informa de la fracción de accesos servidos por
+ *              rangos y de la reducción de recorridos de la tabla de páginas,
+ *              para distintas proporciones de memoria contigua.
+ * Parámetros:
+ *   - num_accesses: número de accesos por experimento.
+ */
+void run_range_comparison(long num_accesses) {
+    const double fractions[] = {0.0, 0.5, 0.9, 1.0};
+    PageTableEntry *table = malloc(RANGE_PAGES * sizeof(PageTableEntry));
+
+    RangeTable example = range_table_build(page_table, sizeof(page_table) / sizeof(PageTableEntry));
+    printf("Tabla del enunciado: %d rangos de al menos %d páginas contiguas\n", example.count, RANGE_MIN_PAGES);
+    free(example.entries);
+
+    printf("Traducción de %ld accesos sobre %d páginas con un TLB de %d entradas\n",
+           num_accesses, RANGE_PAGES, RANGE_TLB_ENTRIES);
+    printf(" %9s %7s %9s %9s %11s %12s %12s %10s %9s\n", "Contigua", "Rangos", "Cubiertas", "TLB",
+           "Por rango", "Recorridos", "Con rangos", "Reducción", "ns/busq.");
+    for (int f = 0; f < 4; f++) {
+        build_extent_table(table, RANGE_PAGES, fractions[f], 0x9FB21C651E98DF25ULL);
+        RangeTable rt = range_table_build(table, RANGE_PAGES);
+        long covered = 0;
+        for (int i = 0; i < rt.count; i++) covered += rt.entries[i].limit - rt.entries[i].base;
+
+        PageTlb tlb;
+        memset(&tlb, 0, sizeof(tlb));
+        for (int i = 0; i < RANGE_TLB_ENTRIES; i++) tlb.page[i] = -1;
+        Workload w = workload_phased(0xE7037ED1A0B428DBULL, RANGE_PAGES, 96, 0.95, 0.3, num_accesses, 4);
+        long tlb_hits = 0, range_hits = 0, walks = 0, mistranslated = 0;
+
+        for (long i = 0; i < num_accesses; i++) {
+            int is_write;
+            int page_number = workload_next(&w, &is_write) >> 12;
+            if (page_tlb_access(&tlb, page_number)) {
+                tlb_hits++;
+                continue;
+            }
+            // Fallo del TLB: sin rangos se recorrería la tabla de páginas
+            int frame = range_translate(&rt, page_number);
+            if (frame != -1) {
+                range_hits++;
+                if (frame != table[page_number].page_frame) mistranslated++;
+            } else {
+                walks++;
+            }
+        }
+        if (mistranslated) {
+            fprintf(stderr, "Error: %ld traducciones por rango no coinciden con la tabla de páginas\n", mistranslated);
+            exit(1);
+        }
+        long baseline_walks = num_accesses - tlb_hits;
+
+        // Coste de la búsqueda binaria, medido aparte sobre páginas aleatorias
+        uint64_t seed = 0x2127599BF4325C37ULL;
+        long found = 0;
+        double start = now_seconds();
+        for (int i = 0; i < 1000000; i++) found += range_lookup(&rt, rng_next(&seed) % RANGE_PAGES) != NULL;
+        double lookup_ns = (now_seconds() - start) * 1e9 / 1000000;
+        __asm__ volatile("" : : "r"(found)); // El resultado se usa: el bucle no se elimina
+
+        printf(" %8.0f%% %7d %8.1f%% %8.1f%% %10.1f%% %12ld %12ld %9.1f%% %9.1f\n",
+               fractions[f] * 100, rt.count, 100.0 * covered / RANGE_PAGES,
+               100.0 * tlb_hits / num_accesses, 100.0 * range_hits / num_accesses,
+               baseline_walks * PAGE_WALK_LEVELS, walks * PAGE_WALK_LEVELS,
+               baseline_walks ? 100.0 * (baseline_walks - walks) / baseline_walks : 0.0,
+               lookup_ns);
+        free(rt.entries);
+    }
+    printf("Recorridos y Con rangos: accesos a memoria de la tabla de páginas (%d por recorrido)\n", PAGE_WALK_LEVELS);
+    free(table);
+}
+
+/**
+ * Función: count_argument
+ * Descripción: Lee el contador opcional de argv[2] (accesos, registros, hilos,
+ *              procesos o páginas, según el modo).
+ * Retorno:
+ *   - El número, el valor por defecto si no se indicó, o -1 si argv[2] no es
+ *     un entero positivo.
+ */
+static long count_argument(int argc, char *argv[], long default_count) {
+    if (argc <= 2) return default_count;
+    char *end;
+    long count = strtol(argv[2], &end, 10);
+    if (end == argv[2] || *end != '\0' || count <= 0) return -1;
+    return count;
+}
+
+/**
+ * Función: main
+ * Descripción: Ejecuta la simulación solicitando al usuario una dirección virtual y calculando
+ *              su dirección física si es posible. También calcula el tamaño del espacio de
+ *              direcciones virtuales. Con un argumento de modo ejecuta en su lugar el
+ *              benchmark del asignador de swap ("swap-bench"), la comparación de la caché
+ *              comprimida ("zswap"), la de memoria en dos niveles ("tiers"), la de
+ *              políticas de conjunto de trabajo ("ws"), la de control de admisión
+ *              ("thrashing"), la del reclamador en segundo plano ("kswapd"), la de
+ *              fork con copia en escritura ("fork"), la del marco cero ("zero-page") o la
+ *              de fusión de páginas ("ksm"), o reproduce una traza de cargas y
+ *              almacenamientos ("replay"), o atiende fallos reales con
+ *              userfaultfd ("uffd"), o compara la traducción con y sin tabla
+ *              de rangos ("ranges").
+ */
+int main(int argc, char *argv[]) {
+    uint32_t virtual_address;
+
+    if (argc > 1 && strcmp(argv[1], "swap-bench") == 0) {
+        long num_threads = count_argument(argc, argv, 8);
+        if (num_threads < 0) {
+            fprintf(stderr, "El número de hilos debe ser un entero positivo\n");
+            return 1;
+        }
+        run_swap_benchmark(num_threads > MAX_CPUS ? MAX_CPUS : (int)num_threads);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "zswap") == 0) {
+        long num_accesses = count_argument(argc, argv, 1000000);
+        if (num_accesses < 0) {
+            fprintf(stderr, "El número de accesos debe ser un entero positivo\n");
+            return 1;
+        }
+        run_zswap_comparison(num_accesses);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "tiers") == 0) {
+        long num_accesses = count_argument(argc, argv, 2000000);
+        if (num_accesses < 0) {
+            fprintf(stderr, "El número de accesos debe ser un entero positivo\n");
+            return 1;
+        }
+        run_tier_comparison(num_accesses);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "ws") == 0) {
+        long num_accesses = count_argument(argc, argv, 1000000);
+        if (num_accesses < 0) {
+            fprintf(stderr, "El número de accesos debe ser un entero positivo\n");
+            return 1;
+        }
+        run_working_set_comparison(num_accesses);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "thrashing") == 0) {
+        long max_procs = count_argument(argc, argv, 6);
+        if (max_procs < 0 || max_procs > THRASHING_MAX_PROCS) {
+            fprintf(stderr, "El número de procesos debe ser un entero entre 1 y %d\n", THRASHING_MAX_PROCS);
+            return 1;
+        }
+        run_thrashing_comparison((int)max_procs);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "kswapd") == 0) {
+        long num_accesses = count_argument(argc, argv, 200000);
+        if (num_accesses < 0) {
+            fprintf(stderr, "El número de accesos debe ser un entero positivo\n");
+            return 1;
+        }
+        run_reclaimer_comparison(num_accesses);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "fork") == 0) {
+        long num_pages = count_argument(argc, argv, 32768);
+        if (num_pages < 0 || num_pages > FORK_MAX_PAGES) {
+            fprintf(stderr, "El número de páginas debe ser un entero entre 1 y %d\n", FORK_MAX_PAGES);
+            return 1;
+        }
+        run_fork_comparison(num_pages < FORK_MIN_PAGES ? FORK_MIN_PAGES : (int)num_pages);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "zero-page") == 0) {
+        long num_accesses = count_argument(argc, argv, 1000000);
+        if (num_accesses < 0) {
+            fprintf(stderr, "El número de accesos debe ser un entero positivo\n");
+            return 1;
+        }
+        run_zero_page_comparison(num_accesses);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "ksm") == 0) {
+        long num_accesses = count_argument(argc, argv, 2000000);
+        if (num_accesses < 0) {
+            fprintf(stderr, "El número de accesos debe ser un entero positivo\n");
+            return 1;
+        }
+        run_ksm_comparison(num_accesses);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "replay") == 0) {
+        // Un argumento numérico es el número de registros; cualquier otro, la ruta de la traza
+        // (un fichero de nombre numérico se indica como ./nombre)
+        char *end = NULL;
+        if (argc > 2) strtol(argv[2], &end, 10);
+        if (argc > 2 && (end == argv[2] || *end != '\0')) {
+            return run_trace_replay(argv[2], 0);
+        }
+        long num_records = count_argument(argc, argv, 20000000);
+        if (num_records < 0) {
+            fprintf(stderr, "El número de registros debe ser un entero positivo\n");
+            return 1;
+        }
+        return run_trace_replay(NULL, num_records);
+    }
+    if (argc > 1 && strcmp(argv[1], "uffd") == 0) {
+        long max_handlers = count_argument(argc, argv, 4);
+        if (max_handlers < 0) {
+            fprintf(stderr, "El número de hilos debe ser un entero positivo\n");
+            return 1;
+        }
+        run_uffd_harness(max_handlers > UFFD_MAX_THREADS ? UFFD_MAX_THREADS : (int)max_handlers);
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "ranges") == 0) {
+        long num_accesses = count_argument(argc, argv, 4000000);
+        if (num_accesses < 0) {
+            fprintf(stderr, "El número de accesos debe ser un entero positivo\n");
+            return 1;
+        }
+        run_range_comparison(num_accesses);
+        return 0;
+    }
 
     // a) Formato de la dirección virtual
     printf("Formato de la dirección virtual:\n");
@@ -87,8 +3588,10 @@ int main() {
     printf("\nIngrese una dirección virtual (en hexadecimal, hasta 32 bits): ");
     scanf("%x", &virtual_address);
 
-    // b) Calcular la dirección física correspondiente
-    int physical_address = get_physical_address(virtual_address);
+    // b) Calcular la dirección física correspondiente (rangos primero, tabla de páginas si fallan)
+    RangeTable ranges = range_table_build(page_table, sizeof(page_table) / sizeof(PageTableEntry));
+    int physical_address = get_physical_address_range(&ranges, virtual_address);
+    free(ranges.entries);
     if (physical_address != -1) {
         printf("Dirección física correspondiente: 0x%X\n", physical_address);
     }